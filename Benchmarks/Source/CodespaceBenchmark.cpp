@@ -0,0 +1,102 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Compares Codespace lookups against the unordered_map which used to hold the tiles.
+// Usage: CodespaceBenchmark [rounds]
+
+#include "Codespace.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace BearLibTerminal;
+
+typedef std::chrono::steady_clock Clock;
+
+static double Nanoseconds(Clock::time_point from, Clock::time_point to)
+{
+	return std::chrono::duration<double, std::nano>(to - from).count();
+}
+
+int main(int argc, char** argv)
+{
+	int rounds = argc > 1? std::atoi(argv[1]): 400;
+
+	// Codes as a typical application would use them: the whole of Basic Latin through
+	// Cyrillic, sparse symbols and box drawing, a private use area tileset and a few
+	// codes from a second font.
+	std::vector<char32_t> codes;
+	for (char32_t code = 0x20; code < 0x500; code++)
+		codes.push_back(code);
+	for (char32_t code = 0x500; code < 0x2600; code += 7)
+		codes.push_back(code);
+	for (char32_t code = 0xE000; code < 0xE400; code++)
+		codes.push_back(code);
+	for (char32_t code = 0x20; code < 0x80; code++)
+		codes.push_back((1 << 24) | code);
+
+	Codespace codespace;
+	Codespace::Container map;
+	for (char32_t code: codes)
+	{
+		auto tile = std::make_shared<TileInfo>();
+		codespace.Add(code, tile);
+		map[code] = tile;
+	}
+
+	// One in eight lookups misses, as codes nothing provides are looked up too.
+	std::mt19937 random(1);
+	std::vector<char32_t> queries(1 << 16);
+	for (auto& query: queries)
+		query = (random() % 8 == 0)? 0x3000 + random() % 0x1000: codes[random() % codes.size()];
+
+	size_t checksum = 0;
+
+	auto start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+	{
+		for (char32_t code: queries)
+		{
+			auto j = map.find(code);
+			checksum += (j == map.end())? 0: (size_t)j->second.get();
+		}
+	}
+
+	auto middle = Clock::now();
+	for (int i = 0; i < rounds; i++)
+	{
+		for (char32_t code: queries)
+			checksum -= (size_t)codespace.Find(code);
+	}
+
+	auto finish = Clock::now();
+	double lookups = double(rounds) * queries.size();
+
+	std::printf("%zu codes, %.0f lookups\n", codes.size(), lookups);
+	std::printf("unordered_map: %.2f ns/lookup\n", Nanoseconds(start, middle) / lookups);
+	std::printf("Codespace:     %.2f ns/lookup\n", Nanoseconds(middle, finish) / lookups);
+
+	// Both must have found the very same tiles.
+	return checksum == 0? EXIT_SUCCESS: EXIT_FAILURE;
+}
@@ -0,0 +1,105 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Checks that tiles evicted from the atlas give their memory back: the atlas space as well as
+// the bitmaps their tileset kept. Evicted tiles must be prepared anew when needed again.
+// Usage: EvictionTest
+
+#include "Atlas.hpp"
+#include "Tileset.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace BearLibTerminal;
+
+int main()
+{
+	// Box drawing and block elements of a few fonts, all generated by the dynamic tileset.
+	std::vector<char32_t> codes;
+	for (char32_t font = 0; font < 4; font++)
+	{
+		for (char32_t code = 0x2500; code <= 0x259F; code++)
+			codes.push_back(font * Tileset::kFontOffsetMultiplier + code);
+	}
+
+	g_atlas.SetBudget(512 << 10);
+	UpdateDynamicTileset(Size(16, 32));
+
+	std::vector<std::weak_ptr<TileInfo>> tiles;
+	for (auto code: codes)
+	{
+		GetTileInfo(code)->last_used = 0;
+		tiles.push_back(g_dynamic_tileset->Get(code));
+	}
+
+	// The first tiles were put again in the last frame.
+	const size_t kept = 16;
+	for (size_t i = 0; i < kept; i++)
+		tiles[i].lock()->last_used = 1;
+
+	size_t used_before = g_atlas.GetUsedMemory();
+	size_t evicted = EvictTiles(1);
+	size_t used_after = g_atlas.GetUsedMemory();
+	g_atlas.CleanUp();
+	g_atlas.Defragment();
+
+	size_t freed = 0, last_freed = 0;
+	for (size_t i = 0; i < tiles.size(); i++)
+	{
+		if (!tiles[i].expired())
+			continue;
+		if (i < kept)
+		{
+			std::printf("Tile %zu was put in the last frame but got evicted\n", i);
+			return EXIT_FAILURE;
+		}
+		freed += 1;
+		last_freed = i;
+	}
+
+	std::printf("%zu tiles, %zu evicted, %zu freed; atlas tiles take %zu bytes, %zu before eviction\n",
+		tiles.size(), evicted, freed, used_after, used_before);
+
+	if (evicted == 0 || used_after >= used_before || used_after > g_atlas.GetBudget() / 2)
+	{
+		std::printf("Eviction did not bring the atlas within half of its budget\n");
+		return EXIT_FAILURE;
+	}
+
+	if (freed != evicted)
+	{
+		std::printf("Evicted tiles are still kept by their tileset\n");
+		return EXIT_FAILURE;
+	}
+
+	// An evicted tile comes back with a bitmap of its own.
+	auto tile = GetTileInfo(codes[last_freed]);
+	if (tile == nullptr || tile->texture == nullptr || tile->bitmap.GetSize() != Size(16, 32) || g_atlas.GetUsedMemory() <= used_after)
+	{
+		std::printf("Evicted tile was not prepared again\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Packs glyph-sized rectangles the way atlas textures do and reports time and occupancy.
+// Usage: SkylinePackerBenchmark [glyphs]
+
+#include "SkylinePacker.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace BearLibTerminal;
+
+typedef std::chrono::steady_clock Clock;
+
+static const int kMaxTextureSize = 4096;
+
+struct Tile
+{
+	size_t texture;
+	Rectangle area;
+};
+
+static double Milliseconds(Clock::time_point from, Clock::time_point to)
+{
+	return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Glyph boxes of a 16px CJK font, with the one pixel border atlas tiles have on each side.
+static Size GetGlyphSize(std::mt19937& random)
+{
+	return Size(8 + random() % 9 + 2, 14 + random() % 5 + 2);
+}
+
+// Same policy as the atlas: every texture is tried in turn, each one growing by doubling
+// its smaller side up to the texture size limit, and a new one is started if none fits.
+static Tile Insert(std::vector<SkylinePacker>& textures, Size size)
+{
+	Point location;
+	for (size_t i = 0; ; i++)
+	{
+		if (i == textures.size())
+			textures.emplace_back(Size(256, 256));
+
+		SkylinePacker& packer = textures[i];
+		while (true)
+		{
+			if (packer.Insert(size, location))
+				return Tile{i, Rectangle(location, size)};
+
+			Size grown = packer.GetSize();
+			(grown.height <= grown.width? grown.height: grown.width) *= 2;
+			if (grown.width > kMaxTextureSize || grown.height > kMaxTextureSize)
+				break;
+
+			packer.Grow(grown);
+		}
+	}
+}
+
+static void Report(const char* stage, double time, const std::vector<SkylinePacker>& textures)
+{
+	long long used = 0, total = 0;
+	for (auto& packer: textures)
+	{
+		used += packer.GetUsedArea();
+		total += packer.GetSize().Area();
+	}
+
+	std::printf("%s: %.1f ms, %zu texture(s), occupancy %.1f%%\n", stage, time, textures.size(), 100.0 * used / total);
+}
+
+// Placements must stay within their textures and never overlap.
+static bool Validate(const std::vector<SkylinePacker>& textures, const std::vector<Tile>& tiles)
+{
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		Size size = textures[i].GetSize();
+		std::vector<bool> taken(size.Area());
+		for (auto& tile: tiles)
+		{
+			if (tile.texture != i)
+				continue;
+
+			const Rectangle& area = tile.area;
+			if (area.left < 0 || area.top < 0 || area.left + area.width > size.width || area.top + area.height > size.height)
+				return false;
+
+			for (int y = area.top; y < area.top + area.height; y++)
+			{
+				for (int x = area.left; x < area.left + area.width; x++)
+				{
+					if (taken[y*size.width + x])
+						return false;
+					taken[y*size.width + x] = true;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	int count = argc > 1? std::atoi(argv[1]): 20000;
+
+	std::mt19937 random(1);
+	std::vector<Size> sizes(count);
+	for (auto& size: sizes)
+		size = GetGlyphSize(random);
+
+	std::vector<SkylinePacker> textures;
+	std::vector<Tile> tiles;
+	tiles.reserve(count);
+
+	auto start = Clock::now();
+	for (auto& size: sizes)
+		tiles.push_back(Insert(textures, size));
+	auto finish = Clock::now();
+
+	std::printf("%d glyphs\n", count);
+	Report("Packed", Milliseconds(start, finish), textures);
+
+	// Half of the glyphs are replaced by others, as when tilesets are reloaded.
+	for (auto& size: sizes)
+		size = GetGlyphSize(random);
+
+	start = Clock::now();
+	for (size_t i = 0; i < tiles.size(); i += 2)
+	{
+		textures[tiles[i].texture].Release(tiles[i].area);
+		tiles[i] = Insert(textures, sizes[i]);
+	}
+	finish = Clock::now();
+
+	Report("Repacked half", Milliseconds(start, finish), textures);
+
+	if (!Validate(textures, tiles))
+	{
+		std::printf("Placements overlap or fall outside their textures\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
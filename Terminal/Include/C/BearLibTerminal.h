@@ -182,6 +182,8 @@
 #define TK_WCHAR            0xC9 /* Unicode codepoint of last produced character */
 #define TK_EVENT            0xCA /* Last dequeued event */
 #define TK_FULLSCREEN       0xCB /* Fullscreen state */
+#define TK_FRAMES_RENDERED  0xCC /* Number of frames actually drawn by refresh */
+#define TK_FRAMES_SKIPPED   0xCD /* Number of refreshes skipped because nothing changed */
 
 /*
  * Other events
@@ -289,6 +291,8 @@ TERMINAL_API color_t color_from_name8(const int8_t* name);
 TERMINAL_API color_t color_from_name16(const int16_t* name);
 TERMINAL_API color_t color_from_name32(const int32_t* name);
 TERMINAL_API int terminal_put_array(int x, int y, int w, int h, const uint8_t* data, int row_stride, int column_stride, const void* layout, int char_size);
+TERMINAL_API int terminal_inject(int code, int x, int y);
+TERMINAL_API const color_t* terminal_frame(int* width, int* height);
 
 #ifdef __cplusplus
 } /* End of extern "C" */
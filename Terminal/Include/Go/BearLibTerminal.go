@@ -175,6 +175,8 @@ const (
 	TK_WCHAR       = 0xC9 /* Unicode codepoint of last produced character */
 	TK_EVENT       = 0xCA /* Last dequeued event */
 	TK_FULLSCREEN  = 0xCB /* Fullscreen state */
+	TK_FRAMES_RENDERED = 0xCC /* Number of frames actually drawn by refresh */
+	TK_FRAMES_SKIPPED  = 0xCD /* Number of refreshes skipped because nothing changed */
 )
 
 //
@@ -159,6 +159,8 @@ const
   TK_WCHAR            = $C9; // Unicode codepoint of last produced character
   TK_EVENT            = $CA; // Last dequeued event
   TK_FULLSCREEN       = $CB; // Fullscreen state
+  TK_FRAMES_RENDERED  = $CC; // Number of frames actually drawn by refresh
+  TK_FRAMES_SKIPPED   = $CD; // Number of refreshes skipped because nothing changed
 
   //Other events
   TK_CLOSE            = $E0;
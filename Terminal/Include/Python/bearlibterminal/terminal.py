@@ -470,6 +470,8 @@ TK_CHAR             = 0xC8 # Translated ANSI code of last produced character
 TK_WCHAR            = 0xC9 # Unicode codepoint of last produced character
 TK_EVENT            = 0xCA # Last dequeued event
 TK_FULLSCREEN       = 0xCB # Fullscreen state
+TK_FRAMES_RENDERED  = 0xCC # Number of frames actually drawn by refresh
+TK_FRAMES_SKIPPED   = 0xCD # Number of refreshes skipped because nothing changed
 
 # Other events.
 TK_CLOSE            = 0xE0
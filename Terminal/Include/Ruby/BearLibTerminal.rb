@@ -292,6 +292,8 @@ module Terminal
         TK_WCHAR            = 0xC9 # Unicode codepoint of last produced character
         TK_EVENT            = 0xCA # Last dequeued event
         TK_FULLSCREEN       = 0xCB # Fullscreen state
+        TK_FRAMES_RENDERED  = 0xCC # Number of frames actually drawn by refresh
+        TK_FRAMES_SKIPPED   = 0xCD # Number of refreshes skipped because nothing changed
 
         # Other events.
         TK_CLOSE            = 0xE0
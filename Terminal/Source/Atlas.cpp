@@ -32,12 +32,13 @@
 namespace BearLibTerminal
 {
 	Atlas g_atlas;
+	std::recursive_mutex g_atlas_lock;
 
-	static int RoundUpTo(int value, int to) // TODO: move to utils
-	{
-		int remainder = value % to;
-		return remainder? value + (to-remainder): value;
-	}
+	// Tiles this big get a texture of their own.
+	static const int kSpriteArea = 100*100; // Arbitrary chosen size.
+
+	// Shared textures start at this size and grow as needed.
+	static const Size kInitialTextureSize{256, 256};
 
 	bool IsPowerOfTwo(unsigned int x)
 	{
@@ -129,16 +130,18 @@ namespace BearLibTerminal
 		tileset(nullptr),
 		texture(nullptr),
 		alignment(TileAlignment::Center),
-		is_animated(false)
+		is_animated(false),
+		instance_index(0),
+		instance_epoch(0),
+		last_used(0)
 	{ }
 
 
 
 	AtlasTexture::AtlasTexture(Size initial_size):
-		m_canvas(initial_size, Color{})
-	{
-		m_spaces.emplace_back(initial_size);
-	}
+		m_canvas(initial_size, Color{}),
+		m_packer(initial_size)
+	{ }
 
 	AtlasTexture::AtlasTexture(std::shared_ptr<TileInfo> sprite)
 	{
@@ -156,6 +159,10 @@ namespace BearLibTerminal
 		m_canvas = Bitmap{size, Color{}};
 		m_canvas.Blit(sprite->bitmap, {});
 
+		Point location;
+		m_packer = SkylinePacker{size};
+		m_packer.Insert(size, location);
+
 		// Update the tile info.
 		sprite->texture = this;
 		sprite->useful_space = Rectangle{size};
@@ -169,6 +176,16 @@ namespace BearLibTerminal
 		return m_tiles.empty();
 	}
 
+	bool AtlasTexture::IsSprite() const
+	{
+		return m_tiles.size() == 1 && m_tiles.front()->useful_space.Area() >= kSpriteArea;
+	}
+
+	int AtlasTexture::GetUsedArea() const
+	{
+		return m_packer.GetUsedArea();
+	}
+
 	bool AtlasTexture::Add(std::shared_ptr<TileInfo> tile)
 	{
 		if (!tile)
@@ -180,39 +197,24 @@ namespace BearLibTerminal
 			return false;
 		}
 
-		// Round tile dimensions to multiple of 4 for more discrete space partitioning
+		// One pixel border around the tile.
 		Bitmap& bitmap = tile->bitmap;
 		Size bitmap_size = bitmap.GetSize();
 		Size tile_size = bitmap_size + Size(2, 2);
-		tile_size.width = RoundUpTo(tile_size.width, 4);
-		tile_size.height = RoundUpTo(tile_size.height, 4);
 
-		auto find_space = [&](Size size) -> decltype(m_spaces.end())
+		// Find suitable free space.
+		Point space;
+		while (!m_packer.Insert(tile_size, space))
 		{
-			while(true)
+			if (!TryGrow())
 			{
-				for (auto i = m_spaces.begin(); i != m_spaces.end(); ++i)
-				{
-					if (i->width >= size.width && i->height >= size.height)
-						return i;
-				}
-
-				if (!TryGrow())
-					return m_spaces.end();
+				// Couldn't find a space to fit this tile even after enlarging to the limits.
+				return false;
 			}
-		};
-
-		// Find suitable free space.
-		auto space = find_space(tile_size);
-
-		if (space == m_spaces.end())
-		{
-			// Couldn't find a space to fit this tile even after enlarging to the limits.
-			return false;
 		}
 
 		// Place the tile on the canvas.
-		Point location = space->Location() + Point{1, 1};
+		Point location = space + Point{1, 1};
 		m_canvas.Blit(bitmap, location);
 
 		// Expand borders for correct texture sampling in scaled/fullscreen mode.
@@ -228,41 +230,7 @@ namespace BearLibTerminal
 		}
 
 		// Mark for texture update.
-		m_dirty_regions.emplace_back(space->Location(), tile_size);
-
-		// Split used space
-		int p3width = (space->width - tile_size.width);
-		int p3height = (space->height - tile_size.height);
-		int p1 = tile_size.width * p3height;
-		int p2 = tile_size.height * p3width;
-		int p3 = p3width * p3height;
-
-		Rectangle cut_space;
-		if (p2 + p3 > p1 + p3)
-		{
-			// Split vertically
-			cut_space = Rectangle(space->left + tile_size.width, space->top, p3width, space->height);
-			space->width = tile_size.width;
-			space->height -= tile_size.height;
-			space->top += tile_size.height;
-		}
-		else
-		{
-			// Split horisontally
-			cut_space = Rectangle(space->left, space->top + tile_size.height, space->width, p3height);
-			space->height = tile_size.height;
-			space->width -= tile_size.width;
-			space->left += tile_size.width;
-		}
-
-		if (cut_space.Area() > 0)
-			m_spaces.push_back(cut_space);
-
-		if (space->Area() == 0)
-			m_spaces.erase(space);
-
-		// Postprocess a bit.
-		m_spaces.sort([](Rectangle& lhs, Rectangle& rhs){return lhs.Area() < rhs.Area();});
+		m_dirty_regions.emplace_back(space, tile_size);
 
 		// Update the tile info.
 		tile->texture = this;//shared_from_this();
@@ -291,19 +259,10 @@ namespace BearLibTerminal
 		new_canvas.Blit(m_canvas, Point{});
 		m_canvas = std::move(new_canvas);
 
-		// Add space
-		if (new_size.width > old_size.width)
-		{
-			// Space added at the left
-			m_spaces.push_back(Rectangle{old_size.width, 0, new_size.width-old_size.width, new_size.height});
-		}
-		else
-		{
-			// Space added at the bottom
-			m_spaces.push_back(Rectangle{0, old_size.height, new_size.width, new_size.height-old_size.height});
-		}
+		m_packer.Grow(new_size);
 
-		LOG(Trace, "grow " << old_size << " -> " << m_canvas.GetSize());
+		LOG(Trace, "grow " << old_size << " -> " << new_size << ", " << m_tiles.size() << " tiles, " <<
+			(100 * (int64_t)m_packer.GetUsedArea() / old_size.Area()) << "% occupied");
 
 		// Texture size has been changed, must recalculate texure coords for slots
 		for (auto& i: m_tiles)
@@ -339,10 +298,29 @@ namespace BearLibTerminal
 
 		if (copy_bitmap_back)
 			tile->bitmap = m_canvas.Extract(tile->useful_space);
+		m_packer.Release(tile->total_space);
 		tile->texture = nullptr;
 		tile->total_space = tile->useful_space = Rectangle{};
 		m_tiles.remove(tile);
-		m_spaces.push_back(tile->total_space);
+	}
+
+	void AtlasTexture::RemoveAll(std::vector<std::shared_ptr<TileInfo>>& tiles)
+	{
+		for (auto& tile: m_tiles)
+		{
+			tile->bitmap = m_canvas.Extract(tile->useful_space);
+			tile->texture = nullptr;
+			tile->total_space = tile->useful_space = Rectangle{};
+			tiles.push_back(tile);
+		}
+
+		m_tiles.clear();
+		m_packer = SkylinePacker{m_canvas.GetSize()};
+	}
+
+	const Bitmap& AtlasTexture::GetCanvas() const
+	{
+		return m_canvas;
 	}
 
 	void AtlasTexture::Bind()
@@ -381,13 +359,6 @@ namespace BearLibTerminal
 		m_texture.Bind();
 	}
 
-	void AtlasTexture::Defragment()
-	{
-		// FIXME: NYI
-
-		m_spaces.sort([](Rectangle& lhs, Rectangle& rhs){return lhs.Area() < rhs.Area();});
-	}
-
 	void AtlasTexture::ApplyTextureFilter()
 	{
 		m_texture.ApplyTextureFilter();
@@ -395,12 +366,17 @@ namespace BearLibTerminal
 
 
 
+	Atlas::Atlas():
+		m_budget(0),
+		m_tiles_removed(false)
+	{ }
+
 	void Atlas::Add(std::shared_ptr<TileInfo> tile)
 	{
 		if (!tile)
 			throw std::runtime_error("Empty reference passed to Atlas::Add");
 
-		if (tile->bitmap.GetSize().Area() >= 100*100) // Arbitrary chosen size.
+		if (tile->bitmap.GetSize().Area() >= kSpriteArea)
 		{
 			m_textures.push_back(std::make_shared<AtlasTexture>(tile));
 		}
@@ -412,25 +388,91 @@ namespace BearLibTerminal
 					return;
 			}
 
-			auto texture = std::make_shared<AtlasTexture>(Size{256, 256});
+			auto texture = std::make_shared<AtlasTexture>(kInitialTextureSize);
 			if (!texture->Add(tile))
 				throw std::runtime_error("Failed to add a tile to a newly constructed texture");
 			m_textures.push_back(texture);
 		}
 	}
 
-	void Atlas::Remove(std::shared_ptr<TileInfo> tile)
+	void Atlas::Remove(std::shared_ptr<TileInfo> tile, bool copy_bitmap_back)
 	{
 		if (!tile || !tile->texture)
 			throw std::runtime_error("Empty reference passed to Atlas::Remove");
 
-		tile->texture->Remove(tile);
+		tile->texture->Remove(tile, copy_bitmap_back);
+		m_tiles_removed = true;
+	}
+
+	size_t Atlas::CountShared(int64_t& used_area, int64_t& total_area) const
+	{
+		size_t count = 0;
+		used_area = total_area = 0;
+		for (auto& texture: m_textures)
+		{
+			if (texture->IsEmpty() || texture->IsSprite())
+				continue;
+			count += 1;
+			used_area += texture->GetUsedArea();
+			total_area += texture->GetCanvas().GetSize().Area();
+		}
+		return count;
+	}
+
+	bool Atlas::IsSparse(size_t count, int64_t used_area, int64_t total_area) const
+	{
+		// Repacked textures are expected to be at least half full. Leave the atlas alone
+		// unless its tiles would fit into fewer textures or most of the space is unused.
+		int64_t max_area = (int64_t)g_max_texture_size * g_max_texture_size;
+		size_t needed = used_area / (max_area / 2) + 1;
+		bool sparse = total_area > kInitialTextureSize.Area() && used_area * 4 < total_area;
+		return count > needed || sparse;
 	}
 
-	void Atlas::Defragment()
+	bool Atlas::IsFragmented() const
 	{
+		if (!m_tiles_removed)
+			return false;
+
+		int64_t used_area, total_area;
+		size_t count = CountShared(used_area, total_area);
+		return count > 0 && IsSparse(count, used_area, total_area);
+	}
+
+	void Atlas::Defragment(bool force)
+	{
+		std::lock_guard<std::recursive_mutex> guard(g_atlas_lock);
+		m_tiles_removed = false;
+
+		int64_t used_area, total_area;
+		size_t count = CountShared(used_area, total_area);
+		if (count == 0)
+			return;
+
+		if (!force && !IsSparse(count, used_area, total_area))
+			return;
+
+		std::vector<std::shared_ptr<TileInfo>> tiles;
 		for (auto& texture: m_textures)
-			texture->Defragment();
+		{
+			if (!texture->IsSprite())
+				texture->RemoveAll(tiles);
+		}
+		CleanUp();
+
+		// Taller tiles first keep the skyline flat.
+		std::stable_sort(tiles.begin(), tiles.end(), [](const std::shared_ptr<TileInfo>& lhs, const std::shared_ptr<TileInfo>& rhs)
+		{
+			return lhs->bitmap.GetSize().height > rhs->bitmap.GetSize().height;
+		});
+
+		for (auto& tile: tiles)
+			Add(tile);
+
+		int64_t new_used_area, new_total_area;
+		size_t new_count = CountShared(new_used_area, new_total_area);
+		LOG(Debug, "Atlas defragmented: " << tiles.size() << " tiles moved from " << count << " textures (" <<
+			total_area << " px) to " << new_count << " (" << new_total_area << " px)");
 	}
 
 	void Atlas::CleanUp()
@@ -448,4 +490,30 @@ namespace BearLibTerminal
 		for (auto texture: m_textures)
 			texture->ApplyTextureFilter();
 	}
+
+	void Atlas::SetBudget(size_t bytes)
+	{
+		m_budget = bytes;
+	}
+
+	size_t Atlas::GetBudget() const
+	{
+		return m_budget;
+	}
+
+	size_t Atlas::GetMemoryUsage() const
+	{
+		size_t result = 0;
+		for (auto& texture: m_textures)
+			result += texture->GetCanvas().GetSize().Area() * sizeof(Color);
+		return result;
+	}
+
+	size_t Atlas::GetUsedMemory() const
+	{
+		size_t result = 0;
+		for (auto& texture: m_textures)
+			result += texture->GetUsedArea() * sizeof(Color);
+		return result;
+	}
 }
@@ -27,13 +27,16 @@
 #include "Bitmap.hpp"
 #include "Texture.hpp"
 #include "Rectangle.hpp"
+#include "SkylinePacker.hpp"
 #include <istream>
 #include <ostream>
 #include <memory>
 #include <list>
+#include <vector>
 #include <set>
 #include <map>
 #include <unordered_map>
+#include <mutex>
 #include "OptionGroup.hpp"
 
 namespace BearLibTerminal
@@ -59,6 +62,8 @@ namespace BearLibTerminal
 	std::wostream& operator<<(std::wostream& s, const TileAlignment& value);
 	std::wistream& operator>>(std::wistream& s, TileAlignment& value);
 
+	int RoundUpToPow2(int x);
+
 	class Tileset;
 
 	class AtlasTexture;
@@ -75,7 +80,11 @@ namespace BearLibTerminal
 		Point offset;
 		Size spacing;
 		TileAlignment alignment;
+		Rectangle quad; // Placement relative to the cell origin for the current cell size, see UpdateTileQuads.
 		bool is_animated;
+		mutable uint32_t instance_index; // Slot in the instanced renderer tile table identified by instance_epoch.
+		mutable uint32_t instance_epoch;
+		uint32_t last_used; // Refresh the tile was last put for, see EvictTiles.
 	};
 
 	class AtlasTexture
@@ -84,11 +93,14 @@ namespace BearLibTerminal
 		AtlasTexture(Size initial_size);
 		AtlasTexture(std::shared_ptr<TileInfo> sprite);
 		bool IsEmpty() const;
+		bool IsSprite() const;
+		int GetUsedArea() const;
 		bool Add(std::shared_ptr<TileInfo> tile);
 		void Remove(std::shared_ptr<TileInfo> tile, bool copy_bitmap_back=false);
+		void RemoveAll(std::vector<std::shared_ptr<TileInfo>>& tiles); // Copies bitmaps back.
 		void Bind();
-		void Defragment();
 		void ApplyTextureFilter();
+		const Bitmap& GetCanvas() const;
 
 	private:
 		bool TryGrow();
@@ -96,25 +108,48 @@ namespace BearLibTerminal
 		Texture m_texture;
 		Bitmap m_canvas;
 		std::list<Rectangle> m_dirty_regions;
-		std::list<Rectangle> m_spaces;
+		SkylinePacker m_packer;
 		std::list<std::shared_ptr<TileInfo>> m_tiles;
 	};
 
 	class Atlas
 	{
 	public:
+		Atlas();
 		void Add(std::shared_ptr<TileInfo> tile);
-		void Remove(std::shared_ptr<TileInfo> tile);
-		void Defragment();
+		void Remove(std::shared_ptr<TileInfo> tile, bool copy_bitmap_back=false);
+
+		// Repacks tiles of shared textures into as few textures as possible. Unless forced,
+		// does nothing while the textures are reasonably full. Must be called with
+		// the OpenGL context current as emptied textures are released.
+		void Defragment(bool force=false);
+
+		// Whether tiles were removed since the last Defragment and left the textures
+		// sparse enough for it to repack them.
+		bool IsFragmented() const;
 		void CleanUp();
 		void Clear();
 		void ApplyTextureFilter();
 
+		// Texture memory the atlas should fit into, in bytes. Zero means no limit.
+		void SetBudget(size_t bytes);
+		size_t GetBudget() const;
+		size_t GetMemoryUsage() const; // Size of all textures.
+		size_t GetUsedMemory() const;  // Part of it taken by tiles.
+
 	private:
+		size_t CountShared(int64_t& used_area, int64_t& total_area) const;
+		bool IsSparse(size_t count, int64_t used_area, int64_t total_area) const;
+
 		std::list<std::shared_ptr<AtlasTexture>> m_textures;
+		size_t m_budget;
+		bool m_tiles_removed;
 	};
 
 	extern Atlas g_atlas;
+
+	// Held while tiles are added to the atlas and while a render thread draws from it.
+	extern std::recursive_mutex g_atlas_lock;
 }
 
 #endif /* ATLAS_HPP_ */
@@ -0,0 +1,97 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "BackgroundTexture.hpp"
+#include "OpenGL.hpp"
+
+namespace BearLibTerminal
+{
+	void BackgroundTexture::Draw(const Scene& scene, const Viewport& viewport)
+	{
+		Update(scene, viewport.stage_size);
+
+		// Texel centers fall strictly inside cells, so nearest filtering reproduces
+		// per-cell quads exactly, including partially transparent ones.
+		Size size = viewport.stage_size * viewport.cellsize;
+		float u = m_stage_size.width / (float)m_size.width;
+		float v = m_stage_size.height / (float)m_size.height;
+		Texture::Enable();
+		Bind();
+		glColor4f(1, 1, 1, 1);
+		glBegin(GL_QUADS);
+		glTexCoord2f(0, 0);
+		glVertex2i(0, 0);
+		glTexCoord2f(0, v);
+		glVertex2i(0, size.height);
+		glTexCoord2f(u, v);
+		glVertex2i(size.width, size.height);
+		glTexCoord2f(u, 0);
+		glVertex2i(size.width, 0);
+		glEnd();
+	}
+
+	void BackgroundTexture::Update(const Scene& scene, Size stage_size)
+	{
+		if (m_handle == 0 || stage_size != m_stage_size)
+		{
+			Size texture_size = stage_size;
+			if (!g_has_texture_npot)
+			{
+				texture_size.width = RoundUpToPow2(texture_size.width);
+				texture_size.height = RoundUpToPow2(texture_size.height);
+			}
+
+			if (m_handle == 0)
+			{
+				glGenTextures(1, &m_handle);
+				Bind();
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			}
+			else
+			{
+				Bind();
+			}
+
+			if (texture_size != m_size)
+			{
+				m_size = texture_size;
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_size.width, m_size.height, 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+			}
+
+			m_stage_size = stage_size;
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stage_size.width, stage_size.height, GL_BGRA, GL_UNSIGNED_BYTE, scene.background.data());
+			return;
+		}
+
+		if (scene.background_dirty.IsEmpty())
+			return;
+
+		Bind();
+		for (int y = 0; y < stage_size.height; y++)
+		{
+			auto& span = scene.background_dirty.rows[y];
+			if (!span.IsEmpty())
+				glTexSubImage2D(GL_TEXTURE_2D, 0, span.left, y, span.right - span.left, 1, GL_BGRA, GL_UNSIGNED_BYTE, &scene.background[y*stage_size.width + span.left]);
+		}
+	}
+}
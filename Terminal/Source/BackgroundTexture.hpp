@@ -0,0 +1,45 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_BACKGROUNDTEXTURE_HPP
+#define BEARLIBTERMINAL_BACKGROUNDTEXTURE_HPP
+
+#include "Renderer.hpp"
+#include "Texture.hpp"
+
+namespace BearLibTerminal
+{
+	// Mirrors Scene::background in a texture with one texel per cell, so the whole
+	// background grid is drawn as a single nearest-filtered quad.
+	class BackgroundTexture: public Texture
+	{
+	public:
+		void Draw(const Scene& scene, const Viewport& viewport);
+
+	private:
+		void Update(const Scene& scene, Size stage_size);
+
+		Size m_stage_size;
+	};
+}
+
+#endif // BEARLIBTERMINAL_BACKGROUNDTEXTURE_HPP
@@ -0,0 +1,357 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "BatchedRenderer.hpp"
+#include "OpenGL.hpp"
+#include "Log.hpp"
+#include <algorithm>
+
+namespace BearLibTerminal
+{
+	// Layers with fewer rows than this per thread are filled on the calling thread alone.
+	static const int kMinBandHeight = 16;
+
+	// How many groups back a run may move to join one with the same texture.
+	static const size_t kMaxRegroupDistance = 16;
+
+	BatchedRenderer::BatchedRenderer(size_t threads):
+		m_pool(std::max<size_t>(threads, 1)),
+		m_batch_count(0),
+		m_unsorted_batch_count(0),
+		m_frame_count(0),
+		m_report_time(std::chrono::steady_clock::now())
+	{ }
+
+	void BatchedRenderer::Draw(const Scene& scene, const Viewport& viewport)
+	{
+		m_vertices.clear();
+		m_batches.clear();
+		m_statistics = RenderStatistics();
+
+		m_background.Draw(scene, viewport);
+
+		auto replacement_tile = viewport.replacement_tile;
+
+		for (auto& slot: scene.layers)
+		{
+			const Layer& layer = slot.second;
+			if (!layer.IsEmpty())
+				DrawLayer(layer, viewport, replacement_tile);
+		}
+
+		Submit(viewport);
+		m_statistics.batches = m_batches.size();
+
+		// Per-second averages are only gathered while they can be logged.
+		if (Log::Instance().level < Log::Level::Trace)
+			return;
+
+		m_batch_count += m_statistics.batches;
+		m_unsorted_batch_count += m_statistics.unsorted_batches;
+		m_frame_count += 1;
+		auto now = std::chrono::steady_clock::now();
+		if (now - m_report_time >= std::chrono::seconds(1))
+		{
+			LOG(Trace, "Batched renderer: " << m_batch_count/m_frame_count << " texture batches per frame, " << m_unsorted_batch_count/m_frame_count << " in leaf order");
+			m_batch_count = m_unsorted_batch_count = m_frame_count = 0;
+			m_report_time = now;
+		}
+	}
+
+	RenderStatistics BatchedRenderer::GetStatistics() const
+	{
+		return m_statistics;
+	}
+
+	void BatchedRenderer::DrawLayer(const Layer& layer, const Viewport& viewport, const TileInfo* replacement_tile)
+	{
+		Rectangle scissors = layer.crop.Area() > 0? viewport.GetLayerScissors(layer): Rectangle();
+
+		size_t bands = std::min<size_t>(m_pool.GetConcurrency(), std::max(1, layer.size.height / kMinBandHeight));
+		m_bands.resize(bands);
+		for (size_t i = 0; i < bands; i++)
+		{
+			m_bands[i].top = (int)(layer.size.height * i / bands);
+			m_bands[i].bottom = (int)(layer.size.height * (i+1) / bands);
+		}
+
+		// Every band fills its own slice of the vertex array, so the slices are sized first.
+		m_pool.Run(bands, [&](size_t i)
+		{
+			Band& band = m_bands[i];
+			band.count = 0;
+			band.stale = 0;
+			layer.ForEachOccupied(band.top, band.bottom, [&](int, int, int index)
+			{
+				for (auto& leaf: layer.GetLeafs(index))
+				{
+					band.count += (leaf.flags & Leaf::CornerColored)? 8: 4;
+					band.stale += (leaf.tile_generation != g_tileset_generation)? 1: 0;
+				}
+			});
+		});
+
+		// LookupTile updates the leafs, so tiles changed since they were put are resolved here.
+		for (auto& band: m_bands)
+		{
+			if (band.stale == 0)
+				continue;
+
+			layer.ForEachOccupied(band.top, band.bottom, [&](int, int, int index)
+			{
+				for (auto& leaf: layer.GetLeafs(index))
+					LookupTile(leaf, replacement_tile);
+			});
+		}
+
+		size_t first = m_vertices.size();
+		for (auto& band: m_bands)
+		{
+			band.first = first;
+			first += band.count;
+		}
+		m_vertices.resize(first);
+
+		// Workers only read the leafs: PeekTile never updates them.
+		m_pool.Run(bands, [&](size_t i)
+		{
+			Band& band = m_bands[i];
+			band.batches.clear();
+			Vertex* out = m_vertices.data() + band.first;
+			layer.ForEachOccupied(band.top, band.bottom, [&](int x, int y, int index)
+			{
+				int left = x * viewport.cellsize.width;
+				int top = y * viewport.cellsize.height;
+
+				for (auto& leaf: layer.GetLeafs(index))
+				{
+					auto tile = PeekTile(leaf, replacement_tile);
+					Begin(band.batches, tile->texture, scissors, out - m_vertices.data());
+					out = AppendTile(out, leaf, *tile, left, top);
+					Point origin = GetTileOrigin(leaf, *tile, left, top);
+					Rectangle& bounds = band.batches.back().bounds;
+					bounds = bounds.Union(Rectangle(origin, tile->quad.Size()));
+				}
+			});
+		});
+
+		Regroup(m_bands.front().first, scissors);
+	}
+
+	void BatchedRenderer::Regroup(size_t first, Rectangle scissors)
+	{
+		m_runs.clear();
+		for (auto& band: m_bands)
+		{
+			for (size_t i = 0; i < band.batches.size(); i++)
+			{
+				auto& batch = band.batches[i];
+				size_t last = (i+1 < band.batches.size())? band.batches[i+1].first: band.first + band.count;
+				m_runs.push_back(Run{batch.texture, batch.bounds, batch.first, last - batch.first, 0});
+			}
+		}
+
+		// A run may be drawn earlier, together with a group of the same texture,
+		// as long as it does not overlap anything drawn in between.
+		m_groups.clear();
+		for (auto& run: m_runs)
+		{
+			size_t target = m_groups.size();
+			for (size_t j = m_groups.size(), distance = 0; j-- > 0 && distance < kMaxRegroupDistance; distance++)
+			{
+				if (m_groups[j].texture == run.texture)
+				{
+					target = j;
+					break;
+				}
+				if (m_groups[j].bounds.Intersection(run.bounds).Area() > 0)
+					break;
+			}
+
+			if (target == m_groups.size())
+				m_groups.push_back(Batch{run.texture, scissors, 0, Rectangle()});
+
+			Batch& group = m_groups[target];
+			group.bounds = group.bounds.Union(run.bounds);
+			group.first += run.count; // Size for now, offset below.
+			run.group = target;
+		}
+
+		m_statistics.unsorted_batches += m_runs.size();
+
+		if (m_groups.size() < m_runs.size())
+		{
+			size_t offset = 0;
+			for (auto& group: m_groups)
+			{
+				size_t size = group.first;
+				group.first = offset;
+				offset += size;
+			}
+
+			m_regrouped.resize(offset);
+			for (auto& run: m_runs)
+			{
+				Batch& group = m_groups[run.group];
+				std::copy_n(m_vertices.begin() + run.first, run.count, m_regrouped.begin() + group.first);
+				group.first += run.count;
+			}
+			std::copy(m_regrouped.begin(), m_regrouped.end(), m_vertices.begin() + first);
+
+			offset = first;
+			for (auto& group: m_groups)
+			{
+				Begin(m_batches, group.texture, scissors, offset);
+				offset = first + group.first;
+			}
+		}
+		else
+		{
+			for (auto& run: m_runs)
+				Begin(m_batches, run.texture, scissors, run.first);
+		}
+	}
+
+	void BatchedRenderer::Begin(std::vector<Batch>& batches, AtlasTexture* texture, Rectangle scissors, size_t first)
+	{
+		if (!batches.empty())
+		{
+			auto& last = batches.back();
+			if (last.texture == texture &&
+				last.scissors.left == scissors.left && last.scissors.top == scissors.top &&
+				last.scissors.width == scissors.width && last.scissors.height == scissors.height)
+			{
+				return;
+			}
+		}
+
+		batches.push_back(Batch{texture, scissors, first, Rectangle()});
+	}
+
+	BatchedRenderer::Vertex* BatchedRenderer::AppendTile(Vertex* out, const Leaf& leaf, const TileInfo& tile, int x, int y)
+	{
+		Point origin = GetTileOrigin(leaf, tile, x, y);
+		int left = origin.x, top = origin.y;
+		int right = left + tile.useful_space.width;
+		int bottom = top + tile.useful_space.height;
+		const TexCoords& tc = tile.texture_coords;
+
+		auto vertex = [&](float x, float y, float u, float v, Color color)
+		{
+			*out++ = Vertex{x, y, u, v, color.r, color.g, color.b, color.a};
+		};
+
+		if (leaf.flags & Leaf::CornerColored)
+		{
+			// Same 2-quad layout as the immediate renderer uses, see DrawTile there.
+			const Color* c = leaf.color;
+			Color center
+			(
+				(c[0].a + c[1].a + c[2].a + c[3].a)/4,
+				(c[0].r + c[1].r + c[2].r + c[3].r)/4,
+				(c[0].g + c[1].g + c[2].g + c[3].g)/4,
+				(c[0].b + c[1].b + c[2].b + c[3].b)/4
+			);
+			float cu = (tc.tu1 + tc.tu2)/2.0f;
+			float cv = (tc.tv1 + tc.tv2)/2.0f;
+			// Integer vertex coordinates, exactly as glVertex2i would truncate them.
+			int cx = (left + right)/2;
+			int cy = (top + bottom)/2;
+
+			// First quad
+			vertex(left, top, tc.tu1, tc.tv1, c[0]);
+			vertex(left, bottom, tc.tu1, tc.tv2, c[1]);
+			vertex(cx, cy, cu, cv, center);
+			vertex(right, top, tc.tu2, tc.tv1, c[3]);
+
+			// Second quad
+			vertex(right, bottom, tc.tu2, tc.tv2, c[2]);
+			vertex(right, top, tc.tu2, tc.tv1, c[3]);
+			vertex(cx, cy, cu, cv, center);
+			vertex(left, bottom, tc.tu1, tc.tv2, c[1]);
+		}
+		else
+		{
+			// Single-colored version
+			vertex(left, top, tc.tu1, tc.tv1, leaf.color[0]);
+			vertex(left, bottom, tc.tu1, tc.tv2, leaf.color[0]);
+			vertex(right, bottom, tc.tu2, tc.tv2, leaf.color[0]);
+			vertex(right, top, tc.tu2, tc.tv1, leaf.color[0]);
+		}
+
+		return out;
+	}
+
+	void BatchedRenderer::Submit(const Viewport& viewport)
+	{
+		if (m_vertices.empty())
+			return;
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &m_vertices[0].x);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &m_vertices[0].u);
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &m_vertices[0].r);
+
+		bool layer_scissors_applied = false;
+
+		for (size_t i = 0; i < m_batches.size(); i++)
+		{
+			auto& batch = m_batches[i];
+			size_t last = (i+1 < m_batches.size())? m_batches[i+1].first: m_vertices.size();
+			if (last == batch.first)
+				continue;
+
+			if (batch.scissors.Area() > 0)
+			{
+				Rectangle scissors = viewport.ClipScissors(batch.scissors);
+				glEnable(GL_SCISSOR_TEST);
+				glScissor(scissors.left, scissors.top, scissors.width, scissors.height);
+				layer_scissors_applied = true;
+			}
+			else if (layer_scissors_applied)
+			{
+				Rectangle scissors = viewport.ClipScissors(viewport.scissors);
+				glScissor(scissors.left, scissors.top, scissors.width, scissors.height);
+				layer_scissors_applied = false;
+			}
+
+			if (batch.texture)
+			{
+				Texture::Enable();
+				batch.texture->Bind();
+			}
+			else
+			{
+				Texture::Disable();
+			}
+
+			glDrawArrays(GL_QUADS, batch.first, last - batch.first);
+		}
+
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+		Texture::Enable();
+	}
+}
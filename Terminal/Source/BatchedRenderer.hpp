@@ -0,0 +1,101 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_BATCHEDRENDERER_HPP
+#define BEARLIBTERMINAL_BATCHEDRENDERER_HPP
+
+#include "Renderer.hpp"
+#include "BackgroundTexture.hpp"
+#include "ThreadPool.hpp"
+#include <vector>
+#include <chrono>
+
+namespace BearLibTerminal
+{
+	// Builds a packed vertex array for the whole frame and submits it with
+	// a single glDrawArrays call per run of leaves sharing a texture and scissors.
+	// Large layers are split into bands of rows filled in parallel, each into its
+	// own slice of the array. Runs are then regrouped by texture where they do not
+	// overlap, so interleaved text and sprites do not rebind textures at every leaf.
+	class BatchedRenderer: public Renderer
+	{
+	public:
+		BatchedRenderer(size_t threads = 1);
+		void Draw(const Scene& scene, const Viewport& viewport);
+		RenderStatistics GetStatistics() const;
+
+	private:
+		struct Vertex
+		{
+			float x, y;
+			float u, v;
+			uint8_t r, g, b, a;
+		};
+
+		struct Batch
+		{
+			AtlasTexture* texture; // nullptr for untextured quads.
+			Rectangle scissors;    // Empty area means stage-wide scissors.
+			size_t first;
+			Rectangle bounds;      // Stage pixels covered by the quads.
+		};
+
+		struct Run
+		{
+			AtlasTexture* texture;
+			Rectangle bounds;
+			size_t first, count;
+			size_t group;          // Index in m_groups.
+		};
+
+		struct Band
+		{
+			int top, bottom;            // Layer rows [top, bottom).
+			size_t first;               // Slice of m_vertices this band fills.
+			size_t count;
+			size_t stale;               // Leafs whose tile is not resolved yet.
+			std::vector<Batch> batches; // Merged into m_batches in band order.
+		};
+
+		void DrawLayer(const Layer& layer, const Viewport& viewport, const TileInfo* replacement_tile);
+		void Regroup(size_t first, Rectangle scissors);
+		static void Begin(std::vector<Batch>& batches, AtlasTexture* texture, Rectangle scissors, size_t first);
+		static Vertex* AppendTile(Vertex* out, const Leaf& leaf, const TileInfo& tile, int x, int y);
+		void Submit(const Viewport& viewport);
+
+		ThreadPool m_pool;
+		std::vector<Band> m_bands;
+		std::vector<Vertex> m_vertices;
+		std::vector<Batch> m_batches;
+		std::vector<Run> m_runs;
+		std::vector<Batch> m_groups;
+		std::vector<Vertex> m_regrouped;
+		BackgroundTexture m_background;
+
+		// Per-second totals of the statistics, logged at trace level.
+		RenderStatistics m_statistics;
+		size_t m_batch_count, m_unsorted_batch_count, m_frame_count;
+		std::chrono::steady_clock::time_point m_report_time;
+	};
+}
+
+#endif // BEARLIBTERMINAL_BATCHEDRENDERER_HPP
@@ -410,3 +410,18 @@ int terminal_put_array(int x, int y, int w, int h, const uint8_t* data, int row_
 
 	return g_instance->PutArray(x, y, w, h, data, row_stride, column_stride, s);
 }
+
+int terminal_inject(int code, int x, int y)
+{
+	if (!g_instance) return 0;
+	return g_instance->Inject(code, x, y);
+}
+
+const color_t* terminal_frame(int* width, int* height)
+{
+	Size size;
+	const Color* data = g_instance? g_instance->GetFrame(size): nullptr;
+	if (width) *width = size.width;
+	if (height) *height = size.height;
+	return (const color_t*)data;
+}
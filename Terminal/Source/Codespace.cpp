@@ -0,0 +1,91 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Codespace.hpp"
+
+namespace BearLibTerminal
+{
+	Codespace::Codespace()
+	{ }
+
+	Codespace::~Codespace()
+	{ }
+
+	TileInfo*& Codespace::Slot(char32_t code)
+	{
+		auto& directory = m_fonts[code >> 24];
+		if (!directory)
+			directory.reset(new Directory());
+
+		auto& page = (*directory)[(code >> kPageBits) & (kDirectorySize-1)];
+		if (!page)
+			page.reset(new Page()); // Value-initialized, i.e. all nullptr.
+
+		return (*page)[code & (kPageSize-1)];
+	}
+
+	void Codespace::Add(char32_t code, std::shared_ptr<TileInfo> tile)
+	{
+		Slot(code) = tile.get();
+		m_tiles[code] = std::move(tile);
+	}
+
+	void Codespace::AddAlias(char32_t code, TileInfo* tile)
+	{
+		Slot(code) = tile;
+		m_aliases.push_back(code);
+	}
+
+	void Codespace::ClearAliases()
+	{
+		for (char32_t code: m_aliases)
+		{
+			if (!m_tiles.count(code))
+				Slot(code) = nullptr;
+		}
+		m_aliases.clear();
+	}
+
+	Codespace::iterator Codespace::Erase(iterator i)
+	{
+		Slot(i->first) = nullptr;
+		return m_tiles.erase(i);
+	}
+
+	Codespace::iterator Codespace::begin()
+	{
+		return m_tiles.begin();
+	}
+
+	Codespace::iterator Codespace::end()
+	{
+		return m_tiles.end();
+	}
+
+	void Codespace::Clear()
+	{
+		m_tiles.clear();
+		m_aliases.clear();
+		for (auto& directory: m_fonts)
+			directory.reset();
+	}
+}
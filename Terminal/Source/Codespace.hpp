@@ -0,0 +1,84 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_CODESPACE_HPP
+#define BEARLIBTERMINAL_CODESPACE_HPP
+
+#include "Atlas.hpp"
+#include <unordered_map>
+#include <memory>
+#include <array>
+#include <vector>
+
+namespace BearLibTerminal
+{
+	// Tiles currently in use, by code. Besides owning the tiles, keeps a direct-mapped
+	// index: font (high 8 bits) -> directory of pages -> page of 4096 consecutive codes.
+	// Directories and pages are allocated on first use and only released by Clear.
+	// The index may also hold aliases: codes no tileset provides, mapped to the tile used
+	// in their place. Aliases are not owned and must be dropped whenever tilesets change.
+	class Codespace
+	{
+	public:
+		typedef std::unordered_map<char32_t, std::shared_ptr<TileInfo>> Container;
+		typedef Container::iterator iterator;
+
+		Codespace();
+		~Codespace();
+		TileInfo* Find(char32_t code) const;
+		void Add(char32_t code, std::shared_ptr<TileInfo> tile);
+		void AddAlias(char32_t code, TileInfo* tile);
+		void ClearAliases();
+		iterator Erase(iterator i);
+		iterator begin();
+		iterator end();
+		void Clear();
+
+	private:
+		static const int kPageBits = 12;
+		static const int kPageSize = 1 << kPageBits;
+		static const int kDirectorySize = 1 << (24 - kPageBits);
+		typedef std::array<TileInfo*, kPageSize> Page;
+		typedef std::array<std::unique_ptr<Page>, kDirectorySize> Directory;
+
+		TileInfo*& Slot(char32_t code);
+
+		Container m_tiles;
+		std::vector<char32_t> m_aliases;
+		std::array<std::unique_ptr<Directory>, 256> m_fonts;
+	};
+
+	inline TileInfo* Codespace::Find(char32_t code) const
+	{
+		const Directory* directory = m_fonts[code >> 24].get();
+		if (directory == nullptr)
+			return nullptr;
+
+		const Page* page = (*directory)[(code >> kPageBits) & (kDirectorySize-1)].get();
+		if (page == nullptr)
+			return nullptr;
+
+		return (*page)[code & (kPageSize-1)];
+	}
+}
+
+#endif // BEARLIBTERMINAL_CODESPACE_HPP
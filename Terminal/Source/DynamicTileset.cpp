@@ -623,4 +623,9 @@ namespace BearLibTerminal
 		m_cache[code] = tile_ref;
 		return tile_ref;
 	}
+
+	void DynamicTileset::Evict(char32_t code)
+	{
+		m_cache.erase(code);
+	}
 }
@@ -35,6 +35,7 @@ namespace BearLibTerminal
 		Size GetBoundingBoxSize();
 		bool Provides(char32_t code);
 		std::shared_ptr<TileInfo> Get(char32_t code);
+		void Evict(char32_t code);
 	private:
 		Size m_tile_size;
 	};
@@ -0,0 +1,187 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "FrameCache.hpp"
+#include "OpenGL.hpp"
+#include "Log.hpp"
+#include <cstdio>
+#include <cstring>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+// OpenGL 3.0 / ARB_framebuffer_object enumerants, not every gl.h has them.
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER 0x8D40
+#define GL_RENDERBUFFER 0x8D41
+#define GL_READ_FRAMEBUFFER 0x8CA8
+#define GL_DRAW_FRAMEBUFFER 0x8CA9
+#define GL_DRAW_FRAMEBUFFER_BINDING 0x8CA6
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+
+namespace BearLibTerminal
+{
+	struct FrameCache::Functions
+	{
+		void (APIENTRY *GenFramebuffers)(GLsizei n, GLuint* framebuffers);
+		void (APIENTRY *DeleteFramebuffers)(GLsizei n, const GLuint* framebuffers);
+		void (APIENTRY *BindFramebuffer)(GLenum target, GLuint framebuffer);
+		GLenum (APIENTRY *CheckFramebufferStatus)(GLenum target);
+		void (APIENTRY *FramebufferRenderbuffer)(GLenum target, GLenum attachment, GLenum renderbuffer_target, GLuint renderbuffer);
+		void (APIENTRY *GenRenderbuffers)(GLsizei n, GLuint* renderbuffers);
+		void (APIENTRY *DeleteRenderbuffers)(GLsizei n, const GLuint* renderbuffers);
+		void (APIENTRY *BindRenderbuffer)(GLenum target, GLuint renderbuffer);
+		void (APIENTRY *RenderbufferStorage)(GLenum target, GLenum format, GLsizei width, GLsizei height);
+		void (APIENTRY *BlitFramebuffer)(GLint sx0, GLint sy0, GLint sx1, GLint sy1, GLint dx0, GLint dy0, GLint dx1, GLint dy1, GLbitfield mask, GLenum filter);
+	};
+
+	FrameCache::FrameCache():
+		m_state(kUninitialized),
+		m_framebuffer(0),
+		m_renderbuffer(0),
+		m_target(0),
+		m_valid(false)
+	{ }
+
+	FrameCache::~FrameCache()
+	{
+		Dispose();
+	}
+
+	bool FrameCache::Initialize()
+	{
+		const char* version = (const char*)glGetString(GL_VERSION);
+		const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+		int major = 0, minor = 0;
+		bool core = version && std::sscanf(version, "%d.%d", &major, &minor) == 2 && major >= 3;
+		if (!core && !(extensions && std::strstr(extensions, "GL_ARB_framebuffer_object")))
+		{
+			LOG(Info, "Framebuffer objects are not supported, frames will not be cached");
+			return false;
+		}
+
+		m_gl = std::make_unique<Functions>();
+
+#define LOAD_GL_FUNCTION(name) \
+		if ((*(void**)&m_gl->name = GetGLProcAddress("gl" #name)) == nullptr) { \
+			LOG(Error, "Failed to load gl" #name); \
+			m_gl.reset(); \
+			return false; \
+		}
+
+		LOAD_GL_FUNCTION(GenFramebuffers);
+		LOAD_GL_FUNCTION(DeleteFramebuffers);
+		LOAD_GL_FUNCTION(BindFramebuffer);
+		LOAD_GL_FUNCTION(CheckFramebufferStatus);
+		LOAD_GL_FUNCTION(FramebufferRenderbuffer);
+		LOAD_GL_FUNCTION(GenRenderbuffers);
+		LOAD_GL_FUNCTION(DeleteRenderbuffers);
+		LOAD_GL_FUNCTION(BindRenderbuffer);
+		LOAD_GL_FUNCTION(RenderbufferStorage);
+		LOAD_GL_FUNCTION(BlitFramebuffer);
+
+#undef LOAD_GL_FUNCTION
+
+		m_gl->GenFramebuffers(1, &m_framebuffer);
+		m_gl->GenRenderbuffers(1, &m_renderbuffer);
+		return true;
+	}
+
+	void FrameCache::Dispose()
+	{
+		if (!m_gl)
+			return;
+
+		if (m_renderbuffer) m_gl->DeleteRenderbuffers(1, &m_renderbuffer);
+		if (m_framebuffer) m_gl->DeleteFramebuffers(1, &m_framebuffer);
+		m_renderbuffer = m_framebuffer = 0;
+		m_gl.reset();
+	}
+
+	bool FrameCache::Begin(Size size)
+	{
+		if (m_state == kUninitialized)
+			m_state = Initialize()? kReady: kUnsupported;
+
+		if (m_state != kReady || size.width <= 0 || size.height <= 0)
+			return false;
+
+		auto& gl = *m_gl;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_target);
+		gl.BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+		if (size != m_size)
+		{
+			gl.BindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer);
+			gl.RenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.width, size.height);
+			gl.BindRenderbuffer(GL_RENDERBUFFER, 0);
+			gl.FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffer);
+			m_size = size;
+
+			if (gl.CheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			{
+				LOG(Warning, "Frame cache framebuffer is incomplete, frames will not be cached");
+				gl.BindFramebuffer(GL_FRAMEBUFFER, m_target);
+				Dispose();
+				m_state = kUnsupported;
+				m_valid = false;
+				return false;
+			}
+		}
+
+		m_valid = false;
+		return true;
+	}
+
+	void FrameCache::End()
+	{
+		m_gl->BindFramebuffer(GL_FRAMEBUFFER, m_target);
+		m_valid = true;
+		Blit();
+	}
+
+	bool FrameCache::Present(Size size)
+	{
+		if (!m_valid || size != m_size)
+			return false;
+
+		Blit();
+		return true;
+	}
+
+	bool FrameCache::HasFrame(Size size) const
+	{
+		return m_valid && size == m_size;
+	}
+
+	void FrameCache::Blit()
+	{
+		// Blits are subject to the scissor test; the next frame sets it up again anyway.
+		glDisable(GL_SCISSOR_TEST);
+		m_gl->BindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+		m_gl->BlitFramebuffer(0, 0, m_size.width, m_size.height, 0, 0, m_size.width, m_size.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		m_gl->BindFramebuffer(GL_FRAMEBUFFER, m_target);
+	}
+}
@@ -0,0 +1,69 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_FRAMECACHE_HPP
+#define BEARLIBTERMINAL_FRAMECACHE_HPP
+
+#include "Size.hpp"
+#include <memory>
+#include <cstdint>
+
+namespace BearLibTerminal
+{
+	// Frames are drawn into an offscreen framebuffer and then copied into the window,
+	// so the window can be repainted (e. g. on expose) without drawing the scene again.
+	// Without framebuffer object support every method is a no-op returning false.
+	class FrameCache
+	{
+	public:
+		FrameCache();
+		~FrameCache();
+
+		// Redirects drawing into the cache, reallocating it if the window size has changed.
+		bool Begin(Size size);
+
+		// Restores the window framebuffer and copies the new frame into it.
+		void End();
+
+		// Copies the cached frame into the window if there is one of this size.
+		bool Present(Size size);
+
+		// Whether the cache holds a complete frame of this size to draw over.
+		bool HasFrame(Size size) const;
+
+	private:
+		struct Functions;
+		bool Initialize();
+		void Dispose();
+		void Blit();
+
+		enum {kUninitialized, kReady, kUnsupported} m_state;
+		std::unique_ptr<Functions> m_gl;
+		uint32_t m_framebuffer;
+		uint32_t m_renderbuffer;
+		int32_t m_target; // Window framebuffer, whatever was bound before the cache.
+		Size m_size;
+		bool m_valid;     // Cache holds a complete frame of m_size.
+	};
+}
+
+#endif // BEARLIBTERMINAL_FRAMECACHE_HPP
@@ -0,0 +1,163 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "HeadlessWindow.hpp"
+#include "OpenGL.hpp"
+#include "Log.hpp"
+#include <algorithm>
+
+#define BEARLIBTERMINAL_BUILDING_LIBRARY
+#include "BearLibTerminal.h"
+
+namespace BearLibTerminal
+{
+	HeadlessWindow::HeadlessWindow(EventHandler handler):
+		Window(handler)
+	{
+		// There is no OpenGL to probe; atlas textures only live in memory here.
+		g_max_texture_size = 8192;
+		g_has_texture_npot = true;
+		LOG(Info, "Using headless window, no display connection will be made");
+	}
+
+	Size HeadlessWindow::GetActualSize()
+	{
+		return m_client_size;
+	}
+
+	void HeadlessWindow::SetTitle(const std::wstring&)
+	{ }
+
+	void HeadlessWindow::SetIcon(const std::wstring&)
+	{ }
+
+	void HeadlessWindow::SetClientSize(const Size& size)
+	{
+		m_client_size = size;
+	}
+
+	void HeadlessWindow::Show()
+	{ }
+
+	void HeadlessWindow::Hide()
+	{ }
+
+	void HeadlessWindow::SwapBuffers()
+	{ }
+
+	void HeadlessWindow::SetVSync(bool)
+	{ }
+
+	void HeadlessWindow::SetResizeable(bool resizeable)
+	{
+		m_resizeable = resizeable;
+	}
+
+	void HeadlessWindow::SetFullscreen(bool fullscreen)
+	{
+		m_fullscreen = fullscreen;
+	}
+
+	void HeadlessWindow::SetCursorVisibility(bool)
+	{ }
+
+	int HeadlessWindow::PumpEvents()
+	{
+		int processed = 0;
+
+		while (!m_injected.empty())
+		{
+			Event event = std::move(m_injected.front());
+			m_injected.pop_front();
+			processed += 1;
+
+			if (event.code == TK_RESIZED)
+			{
+				m_client_size = Size(event[TK_WIDTH], event[TK_HEIGHT]);
+				m_event_handler(std::move(event));
+				m_event_handler(TK_INVALIDATE);
+			}
+			else
+			{
+				m_event_handler(std::move(event));
+			}
+		}
+
+		return processed;
+	}
+
+	bool HeadlessWindow::Inject(int code, int x, int y)
+	{
+		int key = code & ~TK_KEY_RELEASED;
+		bool pressed = !(code & TK_KEY_RELEASED);
+
+		if (key >= TK_A && key <= TK_ALT)
+		{
+			// x is the character the key produces, if any.
+			Event event(code);
+			event[key] = pressed? 1: 0;
+			event[TK_WCHAR] = pressed? x: 0;
+			m_injected.push_back(std::move(event));
+		}
+		else if (key >= TK_MOUSE_LEFT && key <= TK_MOUSE_X2)
+		{
+			// x is the number of consecutive clicks.
+			Event event(code);
+			event[key] = pressed? 1: 0;
+			event[TK_MOUSE_CLICKS] = pressed? std::max(x, 1): 0;
+			m_injected.push_back(std::move(event));
+		}
+		else if (code == TK_MOUSE_MOVE)
+		{
+			// x and y are in window pixels.
+			m_injected.push_back(Event(TK_MOUSE_MOVE, {{TK_MOUSE_PIXEL_X, x}, {TK_MOUSE_PIXEL_Y, y}}));
+		}
+		else if (code == TK_MOUSE_SCROLL)
+		{
+			m_injected.push_back(Event(TK_MOUSE_SCROLL, {{TK_MOUSE_WHEEL, x}}));
+		}
+		else if (code == TK_RESIZED)
+		{
+			// x and y are the new client size in pixels, subject to the same limits a window manager would apply.
+			if (!m_resizeable || m_fullscreen)
+				return false;
+
+			Size size(std::max(x, m_cell_size.width * m_minimum_size.width), std::max(y, m_cell_size.height * m_minimum_size.height));
+			m_injected.push_back(Event(TK_RESIZED, {{TK_WIDTH, size.width}, {TK_HEIGHT, size.height}}));
+		}
+		else if (code == TK_CLOSE)
+		{
+			m_injected.push_back(Event(TK_CLOSE));
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	Bitmap& HeadlessWindow::GetSurface()
+	{
+		return m_surface;
+	}
+}
@@ -0,0 +1,58 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_HEADLESSWINDOW_HPP
+#define BEARLIBTERMINAL_HEADLESSWINDOW_HPP
+
+#include "Window.hpp"
+#include "Bitmap.hpp"
+#include <deque>
+
+namespace BearLibTerminal
+{
+	// A window without any display connection or OpenGL context. The terminal renders
+	// into its surface on the CPU and input arrives only through Inject.
+	class HeadlessWindow: public Window
+	{
+	public:
+		HeadlessWindow(EventHandler handler);
+		Size GetActualSize();
+		void SetTitle(const std::wstring& title);
+		void SetIcon(const std::wstring& filename);
+		void SetClientSize(const Size& size);
+		void Show();
+		void Hide();
+		void SwapBuffers();
+		void SetVSync(bool enabled);
+		void SetResizeable(bool resizeable);
+		void SetFullscreen(bool fullscreen);
+		void SetCursorVisibility(bool visible);
+		int PumpEvents();
+		bool Inject(int code, int x, int y);
+		Bitmap& GetSurface();
+	private:
+		std::deque<Event> m_injected;
+		Bitmap m_surface;
+	};
+}
+
+#endif // BEARLIBTERMINAL_HEADLESSWINDOW_HPP
@@ -0,0 +1,226 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ImmediateRenderer.hpp"
+#include "OpenGL.hpp"
+
+namespace BearLibTerminal
+{
+	static void DrawTile(const Leaf& leaf, const TileInfo& tile, int x, int y)
+	{
+		Point origin = GetTileOrigin(leaf, tile, x, y);
+		int left = origin.x, top = origin.y;
+
+		int right = left + tile.useful_space.width;
+		int bottom = top + tile.useful_space.height;
+
+		if (leaf.flags & Leaf::CornerColored)
+		{
+			/*
+			// Single-quad version (incorrect interpolation)
+			// Top-left
+			glColor4ub(leaf.color[0].r, leaf.color[0].g, leaf.color[0].b, leaf.color[0].a);
+			glTexCoord2f(texture_coords.tu1, texture_coords.tv1);
+			glVertex2i(left, top);
+
+			// Bottom-left
+			glColor4ub(leaf.color[1].r, leaf.color[1].g, leaf.color[1].b, leaf.color[1].a);
+			glTexCoord2f(texture_coords.tu1, texture_coords.tv2);
+			glVertex2i(left, bottom);
+
+			// Bottom-right
+			glColor4ub(leaf.color[2].r, leaf.color[2].g, leaf.color[2].b, leaf.color[2].a);
+			glTexCoord2f(texture_coords.tu2, texture_coords.tv2);
+			glVertex2i(right, bottom);
+
+			// Top-right
+			glColor4ub(leaf.color[3].r, leaf.color[3].g, leaf.color[3].b, leaf.color[3].a);
+			glTexCoord2f(texture_coords.tu2, texture_coords.tv1);
+			glVertex2i(right, top);
+			/*/
+
+			// 2-quad version
+			// Center color
+			int cr = (leaf.color[0].r + leaf.color[1].r + leaf.color[2].r + leaf.color[3].r)/4;
+			int cg = (leaf.color[0].g + leaf.color[1].g + leaf.color[2].g + leaf.color[3].g)/4;
+			int cb = (leaf.color[0].b + leaf.color[1].b + leaf.color[2].b + leaf.color[3].b)/4;
+			int ca = (leaf.color[0].a + leaf.color[1].a + leaf.color[2].a + leaf.color[3].a)/4;
+			// Center texture coords
+			float cu = (tile.texture_coords.tu1 + tile.texture_coords.tu2)/2.0f;
+			float cv = (tile.texture_coords.tv1 + tile.texture_coords.tv2)/2.0f;
+			// Center coordinate
+			float cx = (left + right)/2.0f;
+			float cy = (top + bottom)/2.0f;
+
+			// First quad
+			// Top-left
+			glColor4ub(leaf.color[0].r, leaf.color[0].g, leaf.color[0].b, leaf.color[0].a);
+			glTexCoord2f(tile.texture_coords.tu1, tile.texture_coords.tv1);
+			glVertex2i(left, top);
+			// Bottom-left
+			glColor4ub(leaf.color[1].r, leaf.color[1].g, leaf.color[1].b, leaf.color[1].a);
+			glTexCoord2f(tile.texture_coords.tu1, tile.texture_coords.tv2);
+			glVertex2i(left, bottom);
+			// Center
+			glColor4ub(cr, cg, cb, ca);
+			glTexCoord2f(cu, cv);
+			glVertex2i(cx, cy);
+			// Top-right
+			glColor4ub(leaf.color[3].r, leaf.color[3].g, leaf.color[3].b, leaf.color[3].a);
+			glTexCoord2f(tile.texture_coords.tu2, tile.texture_coords.tv1);
+			glVertex2i(right, top);
+
+			// Second squad
+			// Bottom-right
+			glColor4ub(leaf.color[2].r, leaf.color[2].g, leaf.color[2].b, leaf.color[2].a);
+			glTexCoord2f(tile.texture_coords.tu2, tile.texture_coords.tv2);
+			glVertex2i(right, bottom);
+			// Top-right
+			glColor4ub(leaf.color[3].r, leaf.color[3].g, leaf.color[3].b, leaf.color[3].a);
+			glTexCoord2f(tile.texture_coords.tu2, tile.texture_coords.tv1);
+			glVertex2i(right, top);
+			// Center
+			glColor4ub(cr, cg, cb, ca);
+			glTexCoord2f(cu, cv);
+			glVertex2i(cx, cy);
+			// Bottom-left
+			glColor4ub(leaf.color[1].r, leaf.color[1].g, leaf.color[1].b, leaf.color[1].a);
+			glTexCoord2f(tile.texture_coords.tu1, tile.texture_coords.tv2);
+			glVertex2i(left, bottom);
+			//*/
+		}
+		else
+		{
+			// Single-colored version
+			glColor4ub(leaf.color[0].r, leaf.color[0].g, leaf.color[0].b, leaf.color[0].a);
+
+			// Top-left
+			glTexCoord2f(tile.texture_coords.tu1, tile.texture_coords.tv1);
+			glVertex2i(left, top);
+
+			// Bottom-left
+			glTexCoord2f(tile.texture_coords.tu1, tile.texture_coords.tv2);
+			glVertex2i(left, bottom);
+
+			// Bottom-right
+			glTexCoord2f(tile.texture_coords.tu2, tile.texture_coords.tv2);
+			glVertex2i(right, bottom);
+
+			// Top-right
+			glTexCoord2f(tile.texture_coords.tu2, tile.texture_coords.tv1);
+			glVertex2i(right, top);
+		}
+	}
+
+	void ImmediateRenderer::Draw(const Scene& scene, const Viewport& viewport)
+	{
+		// Backgrounds
+		Texture::Disable();
+		glBegin(GL_QUADS);
+		{
+			int i = 0, left = 0, top = 0;
+			int w = viewport.cellsize.width;
+			int h = viewport.cellsize.height;
+			for (int y=0; y<viewport.stage_size.height; y++)
+			{
+				for (int x=0; x<viewport.stage_size.width; x++)
+				{
+					const Color& c = scene.background[i];
+					if (c.a > 0)
+					{
+						glColor4ub(c.r, c.g, c.b, c.a);
+						glVertex2i(left+0, top+0);
+						glVertex2i(left+0, top+h);
+						glVertex2i(left+w, top+h);
+						glVertex2i(left+w, top+0);
+					}
+
+					i += 1;
+					left += w;
+				}
+
+				left = 0;
+				top += h;
+			}
+		}
+		glEnd();
+
+		Texture::Enable();
+
+		bool layer_scissors_applied = false;
+
+		AtlasTexture* current_texture = nullptr;
+		auto replacement_tile = viewport.replacement_tile;
+
+		glBegin(GL_QUADS);
+		glColor4f(1, 1, 1, 1);
+		for (auto& slot: scene.layers)
+		{
+			const Layer& layer = slot.second;
+			if (layer.IsEmpty())
+				continue;
+
+			if (layer.crop.Area() > 0)
+			{
+				Rectangle scissors = viewport.ClipScissors(viewport.GetLayerScissors(layer));
+
+				glEnd();
+				glEnable(GL_SCISSOR_TEST);
+				glScissor(scissors.left, scissors.top, scissors.width, scissors.height);
+				glBegin(GL_QUADS);
+
+				layer_scissors_applied = true;
+			}
+
+			layer.ForEachOccupied([&](int x, int y, int i)
+			{
+				int left = x * viewport.cellsize.width;
+				int top = y * viewport.cellsize.height;
+
+				for (auto& leaf: layer.GetLeafs(i))
+				{
+					auto tile = LookupTile(leaf, replacement_tile);
+
+					if (tile->texture != current_texture)
+					{
+						glEnd();
+						tile->texture->Bind();
+						current_texture = tile->texture;
+						glBegin(GL_QUADS);
+					}
+
+					DrawTile(leaf, *tile, left, top);
+				}
+			});
+
+			if (layer_scissors_applied)
+			{
+				glEnd();
+				Rectangle scissors = viewport.ClipScissors(viewport.scissors);
+				glScissor(scissors.left, scissors.top, scissors.width, scissors.height);
+				glBegin(GL_QUADS);
+				layer_scissors_applied = false;
+			}
+		}
+		glEnd();
+	}
+}
@@ -0,0 +1,958 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "InstancedRenderer.hpp"
+#include "OpenGL.hpp"
+#include "Log.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+// OpenGL 1.3+ enumerants, not every gl.h has them.
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#define GL_TEXTURE1 0x84C1
+#define GL_TEXTURE2 0x84C2
+#define GL_TEXTURE3 0x84C3
+#define GL_TEXTURE4 0x84C4
+#endif
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+#define GL_INFO_LOG_LENGTH 0x8B84
+#endif
+#ifndef GL_TEXTURE_BUFFER
+#define GL_TEXTURE_BUFFER 0x8C2A
+#endif
+#ifndef GL_RGBA32F
+#define GL_RGBA32F 0x8814
+#endif
+#ifndef GL_RGBA8UI
+#define GL_RGBA8UI 0x8D7C
+#endif
+#ifndef GL_R32UI
+#define GL_R32UI 0x8236
+#endif
+#ifndef GL_RED_INTEGER
+#define GL_RED_INTEGER 0x8D94
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+namespace BearLibTerminal
+{
+	struct InstancedRenderer::Functions
+	{
+		GLuint (APIENTRY *CreateShader)(GLenum type);
+		void (APIENTRY *ShaderSource)(GLuint shader, GLsizei count, const char* const* string, const GLint* length);
+		void (APIENTRY *CompileShader)(GLuint shader);
+		void (APIENTRY *GetShaderiv)(GLuint shader, GLenum name, GLint* params);
+		void (APIENTRY *GetShaderInfoLog)(GLuint shader, GLsizei size, GLsizei* length, char* log);
+		void (APIENTRY *DeleteShader)(GLuint shader);
+		GLuint (APIENTRY *CreateProgram)();
+		void (APIENTRY *AttachShader)(GLuint program, GLuint shader);
+		void (APIENTRY *LinkProgram)(GLuint program);
+		void (APIENTRY *GetProgramiv)(GLuint program, GLenum name, GLint* params);
+		void (APIENTRY *GetProgramInfoLog)(GLuint program, GLsizei size, GLsizei* length, char* log);
+		void (APIENTRY *DeleteProgram)(GLuint program);
+		void (APIENTRY *UseProgram)(GLuint program);
+		GLint (APIENTRY *GetUniformLocation)(GLuint program, const char* name);
+		void (APIENTRY *Uniform1i)(GLint location, GLint value);
+		void (APIENTRY *Uniform2i)(GLint location, GLint x, GLint y);
+		void (APIENTRY *UniformMatrix4fv)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+		void (APIENTRY *GenBuffers)(GLsizei n, GLuint* buffers);
+		void (APIENTRY *BindBuffer)(GLenum target, GLuint buffer);
+		void (APIENTRY *BufferData)(GLenum target, std::ptrdiff_t size, const void* data, GLenum usage);
+		void (APIENTRY *DeleteBuffers)(GLsizei n, const GLuint* buffers);
+		void (APIENTRY *GenVertexArrays)(GLsizei n, GLuint* arrays);
+		void (APIENTRY *BindVertexArray)(GLuint array);
+		void (APIENTRY *DeleteVertexArrays)(GLsizei n, const GLuint* arrays);
+		void (APIENTRY *EnableVertexAttribArray)(GLuint index);
+		void (APIENTRY *VertexAttribIPointer)(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer);
+		void (APIENTRY *VertexAttribDivisor)(GLuint index, GLuint divisor);
+		void (APIENTRY *DrawArraysInstanced)(GLenum mode, GLint first, GLsizei count, GLsizei instances);
+		void (APIENTRY *TexBuffer)(GLenum target, GLenum format, GLuint buffer);
+		void (APIENTRY *ActiveTexture)(GLenum texture);
+	};
+
+	static const uint32_t kCornerColored = 0x80000000;
+
+	// Tilemap cell kinds, combined as flags.
+	static const uint8_t kCellMapped = 0x01;      // Drawn from the grid textures.
+	static const uint8_t kCellPerLeaf = 0x02;     // Drawn as instances after the grid.
+	static const uint8_t kCellOverflowing = 0x04; // Some leaf reaches into the neighbouring cells.
+
+	// Layer is drawn from its grids only if at least this part of it is mapped.
+	static const size_t kDenseLayerDivisor = 4;
+
+	static uint32_t g_last_tile_epoch = 0;
+
+	static uint32_t PackColor(Color color)
+	{
+		uint32_t result;
+		std::memcpy(&result, &color, sizeof(result));
+		return result;
+	}
+
+	// A single-colored leaf is drawn as two triangles, a corner-colored one as four triangles
+	// around the center, the same geometry the batched renderer sends as two quads.
+	static const char* kVertexShader = R"(
+		#version 330
+		uniform mat4 u_projection;
+		uniform ivec2 u_cellsize;
+		uniform samplerBuffer u_metadata;
+		uniform usamplerBuffer u_corners;
+		layout(location = 0) in uvec2 a_cell;
+		layout(location = 1) in ivec2 a_offset;
+		layout(location = 2) in uint a_tile;
+		layout(location = 3) in uint a_color;
+		out vec4 v_color;
+		out vec2 v_texcoord;
+
+		// Top-left, bottom-left, bottom-right, top-right and center.
+		const int kSingle[6] = int[6](0, 1, 2, 0, 2, 3);
+		const int kCorners[12] = int[12](0, 1, 4, 0, 4, 3, 2, 3, 4, 2, 4, 1);
+
+		void main()
+		{
+			bool corner_colored = (a_tile & 0x80000000u) != 0u;
+			int index = int(a_tile & 0x7FFFFFFFu);
+			vec4 geometry = texelFetch(u_metadata, index*2);
+			vec4 texcoords = texelFetch(u_metadata, index*2+1);
+			int corner = corner_colored? kCorners[gl_VertexID]: kSingle[gl_VertexID];
+
+			ivec2 lt = ivec2(a_cell) * u_cellsize + ivec2(geometry.xy) + a_offset;
+			ivec2 rb = lt + ivec2(geometry.zw);
+			ivec2 position;
+			vec2 uv;
+			if (corner == 0) { position = lt; uv = texcoords.xy; }
+			else if (corner == 1) { position = ivec2(lt.x, rb.y); uv = texcoords.xw; }
+			else if (corner == 2) { position = rb; uv = texcoords.zw; }
+			else if (corner == 3) { position = ivec2(rb.x, lt.y); uv = texcoords.zy; }
+			else { position = (lt + rb) / 2; uv = (texcoords.xy + texcoords.zw) / 2.0; }
+
+			uvec4 color; // BGRA
+			if (!corner_colored)
+			{
+				color = uvec4(a_color & 0xFFu, (a_color >> 8) & 0xFFu, (a_color >> 16) & 0xFFu, a_color >> 24);
+			}
+			else if (corner < 4)
+			{
+				color = texelFetch(u_corners, int(a_color) + corner);
+			}
+			else
+			{
+				int base = int(a_color);
+				color = (texelFetch(u_corners, base) + texelFetch(u_corners, base+1) + texelFetch(u_corners, base+2) + texelFetch(u_corners, base+3)) / 4u;
+			}
+
+			gl_Position = u_projection * vec4(vec2(position), 0.0, 1.0);
+			v_color = vec4(color.zyxw) / 255.0;
+			v_texcoord = uv;
+		}
+	)";
+
+	static const char* kFragmentShader = R"(
+		#version 330
+		uniform sampler2D u_atlas;
+		uniform bool u_textured;
+		in vec4 v_color;
+		in vec2 v_texcoord;
+		out vec4 o_color;
+
+		void main()
+		{
+			o_color = u_textured? texture(u_atlas, v_texcoord) * v_color: v_color;
+		}
+	)";
+
+	// Grids cover the whole stage with one quad; every fragment looks up its own cell.
+	static const char* kGridVertexShader = R"(
+		#version 330
+		uniform mat4 u_projection;
+		uniform ivec2 u_stage_size;
+		out vec2 v_position;
+
+		const vec2 kCorners[6] = vec2[6](vec2(0, 0), vec2(0, 1), vec2(1, 1), vec2(0, 0), vec2(1, 1), vec2(1, 0));
+
+		void main()
+		{
+			v_position = kCorners[gl_VertexID] * vec2(u_stage_size);
+			gl_Position = u_projection * vec4(v_position, 0.0, 1.0);
+		}
+	)";
+
+	static const char* kGridFragmentShader = R"(
+		#version 330
+		uniform int u_mode; // 0 for background colors, 1 for tiles.
+		uniform ivec2 u_cellsize;
+		uniform sampler2D u_atlas;
+		uniform samplerBuffer u_metadata;
+		uniform usampler2D u_tiles;
+		uniform sampler2D u_colors;
+		in vec2 v_position;
+		out vec4 o_color;
+
+		void main()
+		{
+			ivec2 cell = ivec2(floor(v_position)) / u_cellsize;
+			vec4 color = texelFetch(u_colors, cell, 0);
+			if (u_mode == 0)
+			{
+				o_color = color;
+				return;
+			}
+
+			uint tile = texelFetch(u_tiles, cell, 0).r;
+			if (tile == 0u)
+				discard;
+
+			int index = int(tile - 1u);
+			vec4 geometry = texelFetch(u_metadata, index*2);
+			vec4 texcoords = texelFetch(u_metadata, index*2+1);
+			vec2 local = v_position - vec2(cell * u_cellsize) - geometry.xy;
+			if (any(lessThan(local, vec2(0.0))) || any(greaterThanEqual(local, geometry.zw)))
+				discard;
+
+			vec2 uv = texcoords.xy + (texcoords.zw - texcoords.xy) * (local / geometry.zw);
+			o_color = texture(u_atlas, uv) * color;
+		}
+	)";
+
+	bool InstancedRenderer::TileMetadata::operator==(const TileMetadata& other) const
+	{
+		return std::memcmp(this, &other, sizeof(TileMetadata)) == 0;
+	}
+
+	InstancedRenderer::Tilemap::Tilemap():
+		valid(false),
+		texture(nullptr),
+		row_words(0),
+		mapped(0),
+		overflowing(0),
+		tiles_texture(0),
+		colors_texture(0)
+	{ }
+
+	InstancedRenderer::InstancedRenderer():
+		m_state(kUninitialized),
+		m_program(0),
+		m_grid_program(0),
+		m_vertex_array(0),
+		m_grid_vertex_array(0),
+		m_instance_buffer(0),
+		m_metadata_buffer(0),
+		m_metadata_texture(0),
+		m_corner_buffer(0),
+		m_corner_texture(0),
+		m_background_texture(0),
+		m_projection_location(-1),
+		m_cellsize_location(-1),
+		m_textured_location(-1),
+		m_grid_projection_location(-1),
+		m_grid_cellsize_location(-1),
+		m_grid_stage_size_location(-1),
+		m_grid_mode_location(-1),
+		m_epoch(0),
+		m_tileset_generation(0),
+		m_metadata_modified(false)
+	{ }
+
+	InstancedRenderer::~InstancedRenderer()
+	{
+		Dispose();
+	}
+
+	void InstancedRenderer::Draw(const Scene& scene, const Viewport& viewport)
+	{
+		if (m_state == kUninitialized)
+		{
+			m_state = Initialize()? kReady: kUnsupported;
+			if (m_state == kUnsupported)
+			{
+				Dispose();
+				LOG(Warning, "Instanced renderer is not supported by this OpenGL context, falling back to batched one");
+				m_fallback = std::make_unique<BatchedRenderer>();
+			}
+		}
+
+		if (m_fallback)
+		{
+			m_fallback->Draw(scene, viewport);
+			return;
+		}
+
+		PrepareTiles(viewport);
+
+		m_instances.clear();
+		m_corners.clear();
+		m_batches.clear();
+
+		UpdateBackground(scene, viewport);
+		m_batches.push_back(Batch{Batch::kBackground, nullptr, Rectangle(), 0, 0, nullptr});
+
+		auto replacement_tile = viewport.replacement_tile;
+
+		for (auto& slot: scene.layers)
+		{
+			const Layer& layer = slot.second;
+			Tilemap& tilemap = m_tilemaps[slot.first];
+			if (layer.IsEmpty())
+			{
+				// Nothing to keep in sync with, grids are rebuilt once the layer is used again.
+				tilemap.valid = false;
+				continue;
+			}
+
+			UpdateTilemap(tilemap, layer, viewport);
+
+			Rectangle scissors = layer.crop.Area() > 0? viewport.GetLayerScissors(layer): Rectangle();
+
+			bool dense = tilemap.overflowing == 0 && tilemap.mapped * kDenseLayerDivisor >= tilemap.tiles.size();
+			if (dense)
+			{
+				m_batches.push_back(Batch{Batch::kTilemap, tilemap.texture, scissors, 0, m_instances.size(), &tilemap});
+
+				// Cells that did not fit into the grid follow in their usual order. None of
+				// them reach out of their cell, so drawing them after the grid is exact.
+				for (int y = 0; y < tilemap.size.height; y++)
+				{
+					const uint64_t* row = tilemap.fallback.data() + y*tilemap.row_words;
+					for (int w = 0; w < tilemap.row_words; w++)
+					{
+						for (uint64_t bits = row[w]; bits != 0; bits &= bits - 1)
+						{
+							int x = w*64 + count_trailing_zeros(bits);
+							AppendLeafs(layer, x, y, y*tilemap.size.width + x, replacement_tile, scissors);
+						}
+					}
+				}
+			}
+			else
+			{
+				layer.ForEachOccupied([&](int x, int y, int i)
+				{
+					AppendLeafs(layer, x, y, i, replacement_tile, scissors);
+				});
+			}
+		}
+
+		for (auto i = m_tilemaps.begin(); i != m_tilemaps.end(); )
+		{
+			if (scene.layers.count(i->first) == 0)
+			{
+				DisposeTilemap(i->second);
+				i = m_tilemaps.erase(i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		Submit(viewport);
+	}
+
+	bool InstancedRenderer::Initialize()
+	{
+		const char* version = (const char*)glGetString(GL_VERSION);
+		int major = 0, minor = 0;
+		if (version == nullptr || std::sscanf(version, "%d.%d", &major, &minor) != 2 || major*10 + minor < 33)
+		{
+			LOG(Info, "Instanced renderer requires OpenGL 3.3, context version is '" << (version? version: "unknown") << "'");
+			return false;
+		}
+
+		m_gl = std::make_unique<Functions>();
+
+#define LOAD_GL_FUNCTION(name) \
+		if ((*(void**)&m_gl->name = GetGLProcAddress("gl" #name)) == nullptr) { \
+			LOG(Error, "Failed to load gl" #name); \
+			m_gl.reset(); \
+			return false; \
+		}
+
+		LOAD_GL_FUNCTION(CreateShader);
+		LOAD_GL_FUNCTION(ShaderSource);
+		LOAD_GL_FUNCTION(CompileShader);
+		LOAD_GL_FUNCTION(GetShaderiv);
+		LOAD_GL_FUNCTION(GetShaderInfoLog);
+		LOAD_GL_FUNCTION(DeleteShader);
+		LOAD_GL_FUNCTION(CreateProgram);
+		LOAD_GL_FUNCTION(AttachShader);
+		LOAD_GL_FUNCTION(LinkProgram);
+		LOAD_GL_FUNCTION(GetProgramiv);
+		LOAD_GL_FUNCTION(GetProgramInfoLog);
+		LOAD_GL_FUNCTION(DeleteProgram);
+		LOAD_GL_FUNCTION(UseProgram);
+		LOAD_GL_FUNCTION(GetUniformLocation);
+		LOAD_GL_FUNCTION(Uniform1i);
+		LOAD_GL_FUNCTION(Uniform2i);
+		LOAD_GL_FUNCTION(UniformMatrix4fv);
+		LOAD_GL_FUNCTION(GenBuffers);
+		LOAD_GL_FUNCTION(BindBuffer);
+		LOAD_GL_FUNCTION(BufferData);
+		LOAD_GL_FUNCTION(DeleteBuffers);
+		LOAD_GL_FUNCTION(GenVertexArrays);
+		LOAD_GL_FUNCTION(BindVertexArray);
+		LOAD_GL_FUNCTION(DeleteVertexArrays);
+		LOAD_GL_FUNCTION(EnableVertexAttribArray);
+		LOAD_GL_FUNCTION(VertexAttribIPointer);
+		LOAD_GL_FUNCTION(VertexAttribDivisor);
+		LOAD_GL_FUNCTION(DrawArraysInstanced);
+		LOAD_GL_FUNCTION(TexBuffer);
+		LOAD_GL_FUNCTION(ActiveTexture);
+
+#undef LOAD_GL_FUNCTION
+
+		auto& gl = *m_gl;
+
+		m_program = BuildProgram(kVertexShader, kFragmentShader);
+		m_grid_program = BuildProgram(kGridVertexShader, kGridFragmentShader);
+		if (m_program == 0 || m_grid_program == 0)
+			return false;
+
+		m_projection_location = gl.GetUniformLocation(m_program, "u_projection");
+		m_cellsize_location = gl.GetUniformLocation(m_program, "u_cellsize");
+		m_textured_location = gl.GetUniformLocation(m_program, "u_textured");
+		gl.UseProgram(m_program);
+		gl.Uniform1i(gl.GetUniformLocation(m_program, "u_atlas"), 0);
+		gl.Uniform1i(gl.GetUniformLocation(m_program, "u_metadata"), 1);
+		gl.Uniform1i(gl.GetUniformLocation(m_program, "u_corners"), 2);
+
+		m_grid_projection_location = gl.GetUniformLocation(m_grid_program, "u_projection");
+		m_grid_cellsize_location = gl.GetUniformLocation(m_grid_program, "u_cellsize");
+		m_grid_stage_size_location = gl.GetUniformLocation(m_grid_program, "u_stage_size");
+		m_grid_mode_location = gl.GetUniformLocation(m_grid_program, "u_mode");
+		gl.UseProgram(m_grid_program);
+		gl.Uniform1i(gl.GetUniformLocation(m_grid_program, "u_atlas"), 0);
+		gl.Uniform1i(gl.GetUniformLocation(m_grid_program, "u_metadata"), 1);
+		gl.Uniform1i(gl.GetUniformLocation(m_grid_program, "u_tiles"), 3);
+		gl.Uniform1i(gl.GetUniformLocation(m_grid_program, "u_colors"), 4);
+		gl.UseProgram(0);
+
+		gl.GenVertexArrays(1, &m_vertex_array);
+		gl.GenVertexArrays(1, &m_grid_vertex_array);
+		gl.GenBuffers(1, &m_instance_buffer);
+		gl.BindVertexArray(m_vertex_array);
+		gl.BindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+		for (GLuint i = 0; i < 4; i++)
+		{
+			gl.EnableVertexAttribArray(i);
+			gl.VertexAttribDivisor(i, 1);
+		}
+		gl.BindVertexArray(0);
+		gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+		auto create_table = [&](GLuint& buffer, GLuint& texture, GLenum format)
+		{
+			gl.GenBuffers(1, &buffer);
+			gl.BindBuffer(GL_TEXTURE_BUFFER, buffer);
+			gl.BufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_BUFFER, texture);
+			gl.TexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+			gl.BindBuffer(GL_TEXTURE_BUFFER, 0);
+		};
+
+		create_table(m_metadata_buffer, m_metadata_texture, GL_RGBA32F);
+		create_table(m_corner_buffer, m_corner_texture, GL_RGBA8UI);
+
+		LOG(Info, "Instanced renderer initialized, OpenGL " << version);
+		return true;
+	}
+
+	uint32_t InstancedRenderer::BuildProgram(const char* vertex_source, const char* fragment_source)
+	{
+		auto& gl = *m_gl;
+
+		auto compile = [&](GLenum type, const char* source) -> GLuint
+		{
+			GLuint shader = gl.CreateShader(type);
+			gl.ShaderSource(shader, 1, &source, nullptr);
+			gl.CompileShader(shader);
+
+			GLint status = 0, length = 0;
+			gl.GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+			if (!status)
+			{
+				gl.GetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+				std::string log(length+1, '\0');
+				gl.GetShaderInfoLog(shader, length, nullptr, &log[0]);
+				LOG(Error, "Failed to compile " << (type == GL_VERTEX_SHADER? "vertex": "fragment") << " shader: " << log.c_str());
+				gl.DeleteShader(shader);
+				return 0;
+			}
+
+			return shader;
+		};
+
+		GLuint vertex_shader = compile(GL_VERTEX_SHADER, vertex_source);
+		GLuint fragment_shader = compile(GL_FRAGMENT_SHADER, fragment_source);
+		if (vertex_shader == 0 || fragment_shader == 0)
+		{
+			if (vertex_shader) gl.DeleteShader(vertex_shader);
+			if (fragment_shader) gl.DeleteShader(fragment_shader);
+			return 0;
+		}
+
+		GLuint program = gl.CreateProgram();
+		gl.AttachShader(program, vertex_shader);
+		gl.AttachShader(program, fragment_shader);
+		gl.LinkProgram(program);
+		gl.DeleteShader(vertex_shader);
+		gl.DeleteShader(fragment_shader);
+
+		GLint status = 0, length = 0;
+		gl.GetProgramiv(program, GL_LINK_STATUS, &status);
+		if (!status)
+		{
+			gl.GetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+			std::string log(length+1, '\0');
+			gl.GetProgramInfoLog(program, length, nullptr, &log[0]);
+			LOG(Error, "Failed to link instanced renderer program: " << log.c_str());
+			gl.DeleteProgram(program);
+			return 0;
+		}
+
+		return program;
+	}
+
+	void InstancedRenderer::Dispose()
+	{
+		if (!m_gl)
+			return;
+
+		auto& gl = *m_gl;
+		for (auto& i: m_tilemaps)
+			DisposeTilemap(i.second);
+		m_tilemaps.clear();
+		if (m_background_texture) glDeleteTextures(1, &m_background_texture);
+		if (m_corner_texture) glDeleteTextures(1, &m_corner_texture);
+		if (m_metadata_texture) glDeleteTextures(1, &m_metadata_texture);
+		if (m_corner_buffer) gl.DeleteBuffers(1, &m_corner_buffer);
+		if (m_metadata_buffer) gl.DeleteBuffers(1, &m_metadata_buffer);
+		if (m_instance_buffer) gl.DeleteBuffers(1, &m_instance_buffer);
+		if (m_grid_vertex_array) gl.DeleteVertexArrays(1, &m_grid_vertex_array);
+		if (m_vertex_array) gl.DeleteVertexArrays(1, &m_vertex_array);
+		if (m_grid_program) gl.DeleteProgram(m_grid_program);
+		if (m_program) gl.DeleteProgram(m_program);
+		m_background_texture = m_corner_texture = m_metadata_texture = 0;
+		m_corner_buffer = m_metadata_buffer = m_instance_buffer = 0;
+		m_grid_vertex_array = m_vertex_array = 0;
+		m_grid_program = m_program = 0;
+		m_gl.reset();
+	}
+
+	void InstancedRenderer::DisposeTilemap(Tilemap& tilemap)
+	{
+		if (tilemap.tiles_texture) glDeleteTextures(1, &tilemap.tiles_texture);
+		if (tilemap.colors_texture) glDeleteTextures(1, &tilemap.colors_texture);
+		tilemap.tiles_texture = tilemap.colors_texture = 0;
+		tilemap.valid = false;
+	}
+
+	void InstancedRenderer::PrepareTiles(const Viewport& viewport)
+	{
+		if (m_tileset_generation != g_tileset_generation || m_cellsize != viewport.cellsize || m_half_cellsize != viewport.half_cellsize)
+		{
+			// Either the tiles themselves or their placement in a cell have changed, start over.
+			m_tileset_generation = g_tileset_generation;
+			m_cellsize = viewport.cellsize;
+			m_half_cellsize = viewport.half_cellsize;
+			if (++g_last_tile_epoch == 0)
+				g_last_tile_epoch = 1;
+			m_epoch = g_last_tile_epoch;
+			m_tiles.clear();
+			m_tile_textures.clear();
+			m_metadata.clear();
+			m_metadata_modified = true;
+			for (auto& i: m_tilemaps)
+				i.second.valid = false;
+			return;
+		}
+
+		// Texture coordinates change whenever an atlas texture grows.
+		for (size_t i = 0; i < m_tiles.size(); i++)
+		{
+			const TileInfo& tile = *m_tiles[i];
+			if (tile.texture != m_tile_textures[i])
+			{
+				m_tile_textures[i] = tile.texture;
+				for (auto& j: m_tilemaps)
+					j.second.valid = false;
+			}
+
+			TileMetadata metadata = MakeMetadata(tile);
+			if (!(metadata == m_metadata[i]))
+			{
+				m_metadata[i] = metadata;
+				m_metadata_modified = true;
+			}
+		}
+	}
+
+	InstancedRenderer::TileMetadata InstancedRenderer::MakeMetadata(const TileInfo& tile) const
+	{
+		const TexCoords& tc = tile.texture_coords;
+		return TileMetadata
+		{
+			(float)tile.quad.left, (float)tile.quad.top,
+			(float)tile.useful_space.width, (float)tile.useful_space.height,
+			tc.tu1, tc.tv1, tc.tu2, tc.tv2
+		};
+	}
+
+	uint32_t InstancedRenderer::GetTileIndex(const TileInfo& tile)
+	{
+		if (tile.instance_epoch != m_epoch)
+		{
+			tile.instance_epoch = m_epoch;
+			tile.instance_index = (uint32_t)m_tiles.size();
+			m_tiles.push_back(&tile);
+			m_tile_textures.push_back(tile.texture);
+			m_metadata.push_back(MakeMetadata(tile));
+			m_metadata_modified = true;
+		}
+
+		return tile.instance_index;
+	}
+
+	void InstancedRenderer::UpdateBackground(const Scene& scene, const Viewport& viewport)
+	{
+		const Size& size = viewport.stage_size;
+
+		if (m_background_size != size || m_background_texture == 0)
+		{
+			if (m_background_texture == 0)
+				glGenTextures(1, &m_background_texture);
+			m_gl->ActiveTexture(GL_TEXTURE3);
+			glBindTexture(GL_TEXTURE_2D, m_background_texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.width, size.height, 0, GL_BGRA, GL_UNSIGNED_BYTE, scene.background.data());
+			m_gl->ActiveTexture(GL_TEXTURE0);
+			m_background_size = size;
+			return;
+		}
+
+		if (scene.background_dirty.IsEmpty())
+			return;
+
+		for (int y = 0; y < size.height; y++)
+		{
+			auto& span = scene.background_dirty.rows[y];
+			if (!span.IsEmpty())
+				UploadGrid(m_background_texture, span.left, y, span.right - span.left, 1, &scene.background[y*size.width + span.left], false);
+		}
+	}
+
+	void InstancedRenderer::UpdateTilemap(Tilemap& tilemap, const Layer& layer, const Viewport& viewport)
+	{
+		auto replacement_tile = viewport.replacement_tile;
+		const Size& size = layer.size;
+
+		if (!tilemap.valid || tilemap.size != size)
+		{
+			if (tilemap.size != size)
+				DisposeTilemap(tilemap);
+
+			size_t cells = size.Area();
+			tilemap.size = size;
+			tilemap.texture = nullptr;
+			tilemap.tiles.assign(cells, 0);
+			tilemap.colors.assign(cells, Color());
+			tilemap.kinds.assign(cells, 0);
+			tilemap.row_words = (size.width + 63) / 64;
+			tilemap.fallback.assign(tilemap.row_words * size.height, 0);
+			tilemap.mapped = 0;
+			tilemap.overflowing = 0;
+
+			layer.ForEachOccupied([&](int x, int y, int)
+			{
+				UpdateTilemapCell(tilemap, layer, x, y, replacement_tile, viewport);
+			});
+
+			auto create = [&](GLuint& texture, GLenum internal_format, GLenum format, GLenum type, const void* data)
+			{
+				if (texture == 0)
+					glGenTextures(1, &texture);
+				m_gl->ActiveTexture(GL_TEXTURE3);
+				glBindTexture(GL_TEXTURE_2D, texture);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				glTexImage2D(GL_TEXTURE_2D, 0, internal_format, size.width, size.height, 0, format, type, data);
+				m_gl->ActiveTexture(GL_TEXTURE0);
+			};
+
+			create(tilemap.tiles_texture, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, tilemap.tiles.data());
+			create(tilemap.colors_texture, GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE, tilemap.colors.data());
+			tilemap.valid = true;
+			return;
+		}
+
+		if (layer.dirty.IsEmpty())
+			return;
+
+		for (int y = 0; y < size.height; y++)
+		{
+			auto& span = layer.dirty.rows[y];
+			if (span.IsEmpty())
+				continue;
+
+			for (int x = span.left; x < span.right; x++)
+				UpdateTilemapCell(tilemap, layer, x, y, replacement_tile, viewport);
+
+			int offset = y*size.width + span.left;
+			UploadGrid(tilemap.tiles_texture, span.left, y, span.right - span.left, 1, &tilemap.tiles[offset], true);
+			UploadGrid(tilemap.colors_texture, span.left, y, span.right - span.left, 1, &tilemap.colors[offset], false);
+		}
+	}
+
+	void InstancedRenderer::UpdateTilemapCell(Tilemap& tilemap, const Layer& layer, int x, int y, const TileInfo* replacement_tile, const Viewport& viewport)
+	{
+		int index = y*tilemap.size.width + x;
+		auto leafs = layer.GetLeafs(index);
+
+		uint8_t kind = 0;
+		uint32_t value = 0;
+		Color color;
+
+		for (auto& leaf: leafs)
+		{
+			auto tile = LookupTile(leaf, replacement_tile);
+			uint32_t tile_index = GetTileIndex(*tile);
+			const TileMetadata& metadata = m_metadata[tile_index];
+
+			int left = (int)metadata.left + leaf.dx;
+			int top = (int)metadata.top + leaf.dy;
+			if (left < 0 || top < 0 || left + (int)metadata.width > viewport.cellsize.width || top + (int)metadata.height > viewport.cellsize.height)
+			{
+				kind |= kCellOverflowing;
+				continue;
+			}
+
+			bool plain = leafs.size() == 1 && leaf.dx == 0 && leaf.dy == 0 && !(leaf.flags & Leaf::CornerColored);
+			if (plain && tile->texture != nullptr)
+			{
+				if (tilemap.texture == nullptr)
+					tilemap.texture = tile->texture;
+
+				if (tile->texture == tilemap.texture)
+				{
+					kind |= kCellMapped;
+					value = tile_index + 1;
+					color = leaf.color[0];
+				}
+			}
+		}
+
+		if (!leafs.empty() && !(kind & kCellMapped))
+			kind |= kCellPerLeaf;
+
+		uint8_t& old_kind = tilemap.kinds[index];
+		tilemap.mapped += (size_t)((kind & kCellMapped) != 0) - (size_t)((old_kind & kCellMapped) != 0);
+		tilemap.overflowing += (size_t)((kind & kCellOverflowing) != 0) - (size_t)((old_kind & kCellOverflowing) != 0);
+		old_kind = kind;
+
+		uint64_t& word = tilemap.fallback[y*tilemap.row_words + x/64];
+		uint64_t bit = uint64_t(1) << (x % 64);
+		if (kind & kCellPerLeaf)
+			word |= bit;
+		else
+			word &= ~bit;
+
+		tilemap.tiles[index] = value;
+		tilemap.colors[index] = color;
+	}
+
+	void InstancedRenderer::UploadGrid(uint32_t texture, int x, int y, int width, int height, const void* data, bool integer)
+	{
+		m_gl->ActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		if (integer)
+			glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RED_INTEGER, GL_UNSIGNED_INT, data);
+		else
+			glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_BGRA, GL_UNSIGNED_BYTE, data);
+		m_gl->ActiveTexture(GL_TEXTURE0);
+	}
+
+	void InstancedRenderer::AppendLeafs(const Layer& layer, int x, int y, int index, const TileInfo* replacement_tile, const Rectangle& scissors)
+	{
+		for (auto& leaf: layer.GetLeafs(index))
+		{
+			auto tile = LookupTile(leaf, replacement_tile);
+			Begin(tile->texture, scissors, (leaf.flags & Leaf::CornerColored)? 12: 6);
+
+			Instance instance{(uint16_t)x, (uint16_t)y, leaf.dx, leaf.dy, GetTileIndex(*tile), 0};
+			if (leaf.flags & Leaf::CornerColored)
+			{
+				instance.tile |= kCornerColored;
+				instance.color = (uint32_t)m_corners.size();
+				m_corners.insert(m_corners.end(), leaf.color, leaf.color+4);
+			}
+			else
+			{
+				instance.color = PackColor(leaf.color[0]);
+			}
+			m_instances.push_back(instance);
+		}
+	}
+
+	void InstancedRenderer::Begin(AtlasTexture* texture, Rectangle scissors, int vertices)
+	{
+		if (!m_batches.empty())
+		{
+			auto& last = m_batches.back();
+			if (last.kind == Batch::kInstances && last.texture == texture && last.vertices == vertices &&
+				last.scissors.left == scissors.left && last.scissors.top == scissors.top &&
+				last.scissors.width == scissors.width && last.scissors.height == scissors.height)
+			{
+				return;
+			}
+		}
+
+		m_batches.push_back(Batch{Batch::kInstances, texture, scissors, vertices, m_instances.size(), nullptr});
+	}
+
+	void InstancedRenderer::Submit(const Viewport& viewport)
+	{
+		auto& gl = *m_gl;
+
+		if (m_metadata_modified && !m_metadata.empty())
+		{
+			gl.BindBuffer(GL_TEXTURE_BUFFER, m_metadata_buffer);
+			gl.BufferData(GL_TEXTURE_BUFFER, m_metadata.size() * sizeof(TileMetadata), m_metadata.data(), GL_STREAM_DRAW);
+			m_metadata_modified = false;
+		}
+		if (!m_corners.empty())
+		{
+			gl.BindBuffer(GL_TEXTURE_BUFFER, m_corner_buffer);
+			gl.BufferData(GL_TEXTURE_BUFFER, m_corners.size() * sizeof(Color), m_corners.data(), GL_STREAM_DRAW);
+		}
+		gl.BindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		gl.ActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_BUFFER, m_metadata_texture);
+		gl.ActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_BUFFER, m_corner_texture);
+		gl.ActiveTexture(GL_TEXTURE0);
+
+		GLfloat projection[16];
+		glGetFloatv(GL_PROJECTION_MATRIX, projection);
+		Size stage_size = viewport.stage_size * viewport.cellsize;
+		gl.UseProgram(m_grid_program);
+		gl.UniformMatrix4fv(m_grid_projection_location, 1, GL_FALSE, projection);
+		gl.Uniform2i(m_grid_cellsize_location, viewport.cellsize.width, viewport.cellsize.height);
+		gl.Uniform2i(m_grid_stage_size_location, stage_size.width, stage_size.height);
+		gl.UseProgram(m_program);
+		gl.UniformMatrix4fv(m_projection_location, 1, GL_FALSE, projection);
+		gl.Uniform2i(m_cellsize_location, viewport.cellsize.width, viewport.cellsize.height);
+
+		if (!m_instances.empty())
+		{
+			gl.BindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+			gl.BufferData(GL_ARRAY_BUFFER, m_instances.size() * sizeof(Instance), m_instances.data(), GL_STREAM_DRAW);
+		}
+
+		bool layer_scissors_applied = false;
+		GLuint current_program = m_program;
+
+		for (size_t i = 0; i < m_batches.size(); i++)
+		{
+			auto& batch = m_batches[i];
+			size_t last = (i+1 < m_batches.size())? m_batches[i+1].first: m_instances.size();
+			if (batch.kind == Batch::kInstances && last == batch.first)
+				continue;
+
+			if (batch.scissors.Area() > 0)
+			{
+				Rectangle scissors = viewport.ClipScissors(batch.scissors);
+				glEnable(GL_SCISSOR_TEST);
+				glScissor(scissors.left, scissors.top, scissors.width, scissors.height);
+				layer_scissors_applied = true;
+			}
+			else if (layer_scissors_applied)
+			{
+				Rectangle scissors = viewport.ClipScissors(viewport.scissors);
+				glScissor(scissors.left, scissors.top, scissors.width, scissors.height);
+				layer_scissors_applied = false;
+			}
+
+			if (batch.texture)
+				batch.texture->Bind();
+
+			if (batch.kind == Batch::kInstances)
+			{
+				if (current_program != m_program)
+				{
+					gl.UseProgram(current_program = m_program);
+					gl.BindVertexArray(m_vertex_array);
+				}
+				gl.Uniform1i(m_textured_location, batch.texture != nullptr);
+
+				// There is no base instance in GL 3.3, attributes are pointed at the batch instead.
+				const char* base = (const char*)(batch.first * sizeof(Instance));
+				gl.VertexAttribIPointer(0, 2, GL_UNSIGNED_SHORT, sizeof(Instance), base + offsetof(Instance, x));
+				gl.VertexAttribIPointer(1, 2, GL_SHORT, sizeof(Instance), base + offsetof(Instance, dx));
+				gl.VertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(Instance), base + offsetof(Instance, tile));
+				gl.VertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(Instance), base + offsetof(Instance, color));
+				gl.DrawArraysInstanced(GL_TRIANGLES, 0, batch.vertices, (GLsizei)(last - batch.first));
+			}
+			else
+			{
+				if (current_program != m_grid_program)
+				{
+					gl.UseProgram(current_program = m_grid_program);
+					gl.BindVertexArray(m_grid_vertex_array);
+				}
+
+				bool background = batch.kind == Batch::kBackground;
+				gl.Uniform1i(m_grid_mode_location, background? 0: 1);
+				gl.ActiveTexture(GL_TEXTURE3);
+				glBindTexture(GL_TEXTURE_2D, background? 0: batch.tilemap->tiles_texture);
+				gl.ActiveTexture(GL_TEXTURE4);
+				glBindTexture(GL_TEXTURE_2D, background? m_background_texture: batch.tilemap->colors_texture);
+				gl.ActiveTexture(GL_TEXTURE0);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+			}
+		}
+
+		gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+		gl.BindVertexArray(0);
+		gl.UseProgram(0);
+	}
+}
@@ -0,0 +1,143 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_INSTANCEDRENDERER_HPP
+#define BEARLIBTERMINAL_INSTANCEDRENDERER_HPP
+
+#include "Renderer.hpp"
+#include "BatchedRenderer.hpp"
+#include <vector>
+#include <memory>
+#include <map>
+
+namespace BearLibTerminal
+{
+	// Uploads one 16-byte record per leaf and lets a GL 3.3 vertex shader expand it
+	// into a quad using a table of the tiles in use. Dense layers of plain single-leaf
+	// cells are instead kept as cell-grid textures and drawn with one quad per layer.
+	// Falls back to the batched renderer if the context cannot run it.
+	class InstancedRenderer: public Renderer
+	{
+	public:
+		InstancedRenderer();
+		~InstancedRenderer();
+		void Draw(const Scene& scene, const Viewport& viewport);
+
+	private:
+		struct Instance
+		{
+			uint16_t x, y;   // Cell.
+			int16_t dx, dy;
+			uint32_t tile;   // Index in the tile table, kCornerColored flag.
+			uint32_t color;  // BGRA8 color or, for corner-colored leafs, index of the first of four in the corner table.
+		};
+
+		struct TileMetadata
+		{
+			float left, top;     // Quad origin relative to the cell, alignment already applied.
+			float width, height;
+			float tu1, tv1, tu2, tv2;
+			bool operator==(const TileMetadata& other) const;
+		};
+
+		// Cell grids of one layer, mirrored in two textures and updated from the frontbuffer dirty spans.
+		struct Tilemap
+		{
+			Tilemap();
+			bool valid;                     // Grids must be rebuilt from scratch when false.
+			Size size;
+			AtlasTexture* texture;          // The only atlas texture grid cells may refer to.
+			std::vector<uint32_t> tiles;    // Tile table index + 1, zero for cells drawn per leaf.
+			std::vector<Color> colors;
+			std::vector<uint8_t> kinds;     // Cell kind, see InstancedRenderer.cpp.
+			std::vector<uint64_t> fallback; // One bit per cell drawn per leaf, rows padded to whole words.
+			int row_words;
+			size_t mapped;                  // Number of cells in the grid.
+			size_t overflowing;             // Number of cells with leafs reaching out of the cell.
+			uint32_t tiles_texture;
+			uint32_t colors_texture;
+		};
+
+		struct Batch
+		{
+			enum Kind {kInstances, kBackground, kTilemap} kind;
+			AtlasTexture* texture; // nullptr for untextured quads.
+			Rectangle scissors;    // Empty area means stage-wide scissors.
+			int vertices;          // 6 for a plain quad, 12 for a corner-colored one.
+			size_t first;
+			const Tilemap* tilemap;
+		};
+
+		struct Functions;
+
+		bool Initialize();
+		uint32_t BuildProgram(const char* vertex_source, const char* fragment_source);
+		void Dispose();
+		void DisposeTilemap(Tilemap& tilemap);
+		void PrepareTiles(const Viewport& viewport);
+		uint32_t GetTileIndex(const TileInfo& tile);
+		TileMetadata MakeMetadata(const TileInfo& tile) const;
+		void UpdateBackground(const Scene& scene, const Viewport& viewport);
+		void UpdateTilemap(Tilemap& tilemap, const Layer& layer, const Viewport& viewport);
+		void UpdateTilemapCell(Tilemap& tilemap, const Layer& layer, int x, int y, const TileInfo* replacement_tile, const Viewport& viewport);
+		void UploadGrid(uint32_t texture, int x, int y, int width, int height, const void* data, bool integer);
+		void AppendLeafs(const Layer& layer, int x, int y, int index, const TileInfo* replacement_tile, const Rectangle& scissors);
+		void Begin(AtlasTexture* texture, Rectangle scissors, int vertices);
+		void Submit(const Viewport& viewport);
+
+		enum {kUninitialized, kReady, kUnsupported} m_state;
+		std::unique_ptr<Functions> m_gl;
+		std::unique_ptr<BatchedRenderer> m_fallback;
+		uint32_t m_program;
+		uint32_t m_grid_program;
+		uint32_t m_vertex_array;
+		uint32_t m_grid_vertex_array;
+		uint32_t m_instance_buffer;
+		uint32_t m_metadata_buffer;
+		uint32_t m_metadata_texture;
+		uint32_t m_corner_buffer;
+		uint32_t m_corner_texture;
+		uint32_t m_background_texture;
+		Size m_background_size;
+		int m_projection_location;
+		int m_cellsize_location;
+		int m_textured_location;
+		int m_grid_projection_location;
+		int m_grid_cellsize_location;
+		int m_grid_stage_size_location;
+		int m_grid_mode_location;
+		uint32_t m_epoch;              // Identifies this renderer's tile table in TileInfo::instance_epoch.
+		uint32_t m_tileset_generation;
+		Size m_cellsize;
+		Size m_half_cellsize;
+		std::vector<const TileInfo*> m_tiles;
+		std::vector<AtlasTexture*> m_tile_textures;
+		std::vector<TileMetadata> m_metadata;
+		bool m_metadata_modified;
+		std::map<int, Tilemap> m_tilemaps;
+		std::vector<Instance> m_instances;
+		std::vector<Color> m_corners;
+		std::vector<Batch> m_batches;
+	};
+}
+
+#endif // BEARLIBTERMINAL_INSTANCEDRENDERER_HPP
@@ -801,6 +801,8 @@ luaterminal_constants[] =
 	CONST(TK_WCHAR),
 	CONST(TK_EVENT),
 	CONST(TK_FULLSCREEN),
+	CONST(TK_FRAMES_RENDERED),
+	CONST(TK_FRAMES_SKIPPED),
 	CONST(TK_CLOSE),
 	CONST(TK_RESIZED),
 	CONST(TK_OFF),
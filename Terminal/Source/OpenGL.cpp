@@ -24,6 +24,11 @@
 #include "Log.hpp"
 #include <string>
 #include <algorithm>
+#if defined(__linux)
+#include <GL/glx.h>
+#elif defined(__APPLE__)
+#include <dlfcn.h>
+#endif
 
 namespace BearLibTerminal
 {
@@ -43,4 +48,15 @@ namespace BearLibTerminal
 		g_has_texture_npot = extensions.find("gl_arb_texture_non_power_of_two") != std::string::npos;
 		LOG(Info, "OpenGL: GPU " << (g_has_texture_npot? "supports": "does not support") << " NPOTD textures");
 	}
+
+	void* GetGLProcAddress(const char* name)
+	{
+#if defined(_WIN32)
+		return (void*)wglGetProcAddress(name);
+#elif defined(__linux)
+		return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#elif defined(__APPLE__)
+		return dlsym(RTLD_DEFAULT, name);
+#endif
+	}
 }
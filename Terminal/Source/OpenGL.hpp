@@ -47,6 +47,9 @@ namespace BearLibTerminal
 	extern int g_texture_filter;
 
 	void ProbeOpenGL();
+
+	// Entry points past OpenGL 1.1 have to be queried at runtime on some platforms.
+	void* GetGLProcAddress(const char* name);
 }
 
 #endif // BEARLIBTERMINAL_OPENGL_HPP
@@ -35,10 +35,15 @@ namespace BearLibTerminal
 		window_resizeable(false),
 		window_minimum_size(1, 1),
 		window_fullscreen(false),
+		window_backend(L"native"),
 		output_postformatting(true),
 		output_vsync(true),
 		output_tab_width(4),
 		output_texture_filter(GL_LINEAR),
+		output_renderer(L"immediate"),
+		output_render_threads(1),
+		output_asynchronous(false),
+		output_atlas_budget(0),
 		input_precise_mouse(false),
 		input_cursor_symbol('_'),
 		input_cursor_blink_rate(500),
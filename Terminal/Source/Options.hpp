@@ -45,12 +45,17 @@ namespace BearLibTerminal
 		bool window_resizeable;
 		Size window_minimum_size;
 		bool window_fullscreen;
+		std::wstring window_backend;
 
 		// Output
 		bool output_postformatting;
 		bool output_vsync;
 		int output_tab_width;
 		int output_texture_filter;
+		std::wstring output_renderer;
+		int output_render_threads;
+		bool output_asynchronous;
+		int output_atlas_budget; // Megabytes, zero for no limit.
 
 		// Input
 		bool input_precise_mouse;
@@ -25,6 +25,7 @@
 
 #include "Point.hpp"
 #include "Size.hpp"
+#include <algorithm>
 
 namespace BearLibTerminal
 {
@@ -123,6 +124,22 @@ namespace BearLibTerminal
 			return result;
 		}
 
+		// Bounding box of both; an empty rectangle does not extend the other one.
+		BasicRectangle<T> Union(BasicRectangle<T> other) const
+		{
+			if (other.width <= 0 || other.height <= 0)
+				return *this;
+			if (width <= 0 || height <= 0)
+				return other;
+
+			BasicRectangle<T> result;
+			result.left = std::min(left, other.left);
+			result.top = std::min(top, other.top);
+			result.width = std::max(left + width, other.left + other.width) - result.left;
+			result.height = std::max(top + height, other.top + other.height) - result.top;
+			return result;
+		}
+
 		BasicPoint<T> Clamp(BasicPoint<T> point) const
 		{
 			if (point.x < left)
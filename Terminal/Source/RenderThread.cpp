@@ -0,0 +1,231 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "RenderThread.hpp"
+#include "Log.hpp"
+#include <algorithm>
+
+namespace BearLibTerminal
+{
+	RenderThread::Frame::Frame():
+		flags(0)
+	{ }
+
+	static void Accumulate(DirtyRows& target, const DirtyRows& source)
+	{
+		if (source.IsEmpty())
+			return;
+
+		for (int y = 0; y < (int)source.rows.size(); y++)
+		{
+			const DirtyRows::Span& span = source.rows[y];
+			if (!span.IsEmpty())
+				target.Mark(Rectangle(span.left, y, span.right-span.left, 1));
+		}
+	}
+
+	static bool HasSameLayers(const Scene& a, const Scene& b)
+	{
+		if (a.layers.size() != b.layers.size())
+			return false;
+
+		for (auto i = a.layers.begin(), j = b.layers.begin(); i != a.layers.end(); i++, j++)
+		{
+			if (i->first != j->first)
+				return false;
+		}
+
+		return true;
+	}
+
+	// Brings target up to date with source, which differs from it only in the outdated cells.
+	static void Update(Scene& target, const Scene& source, const DirtyRows& outdated)
+	{
+		int width = source.size.width;
+		for (int y = 0; y < source.size.height; y++)
+		{
+			const DirtyRows::Span& span = outdated.rows[y];
+			if (span.IsEmpty())
+				continue;
+
+			auto first = source.background.begin() + y*width;
+			std::copy(first + span.left, first + span.right, target.background.begin() + y*width + span.left);
+		}
+		target.background_dirty = source.background_dirty;
+
+		auto j = target.layers.begin();
+		for (auto i = source.layers.begin(); i != source.layers.end(); i++, j++)
+		{
+			const Layer& source_layer = i->second;
+			Layer& target_layer = j->second;
+			target_layer.crop = source_layer.crop;
+			target_layer.dirty = source_layer.dirty;
+
+			if (source_layer.IsEmpty())
+			{
+				if (!target_layer.IsEmpty())
+					target_layer.Clear();
+				continue;
+			}
+
+			for (int y = 0; y < source.size.height; y++)
+			{
+				const DirtyRows::Span& span = outdated.rows[y];
+				for (int x = span.left, index = y*width+span.left; x < span.right; x++, index++)
+					target_layer.Assign(index, source_layer.GetLeafs(index));
+			}
+		}
+	}
+
+	std::unique_ptr<RenderThread> RenderThread::Create(Window& window, Callback callback)
+	{
+		if (!window.ReleaseRC())
+		{
+			LOG(Warning, "This window cannot render from a separate thread");
+			return nullptr;
+		}
+
+		std::unique_ptr<RenderThread> result(new RenderThread(window, std::move(callback)));
+		std::unique_lock<std::mutex> guard(result->m_lock);
+		result->m_wake.wait(guard, [&]{return result->m_state != kStarting;});
+		if (result->m_state == kFailed)
+		{
+			guard.unlock();
+			result.reset();
+			window.AcquireRC();
+			LOG(Warning, "Failed to bind OpenGL context to the render thread");
+			return nullptr;
+		}
+
+		return result;
+	}
+
+	RenderThread::RenderThread(Window& window, Callback callback):
+		m_window(window),
+		m_callback(std::move(callback)),
+		m_writing(0),
+		m_ready(1),
+		m_reading(2),
+		m_fresh(false),
+		m_stop(false),
+		m_state(kStarting),
+		m_submitted(0),
+		m_dropped(0)
+	{
+		m_thread = std::thread(&RenderThread::Run, this);
+	}
+
+	RenderThread::~RenderThread()
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		m_thread.join();
+
+		if (m_state == kRunning)
+		{
+			// Context goes back to the thread that created it.
+			m_window.AcquireRC();
+			LOG(Info, "Render thread stopped, " << m_submitted << " frames submitted, " << m_dropped << " dropped");
+		}
+	}
+
+	void RenderThread::Submit(const Scene& scene, const Viewport& viewport, int flags)
+	{
+		// Changes are recorded for every frame of the same size, whichever thread holds it.
+		for (size_t i = 0; i < m_frames.size(); i++)
+		{
+			if (m_frames[i].scene.size != scene.size)
+				continue;
+
+			Accumulate(m_outdated[i], scene.background_dirty);
+			for (auto& j: scene.layers)
+				Accumulate(m_outdated[i], j.second.dirty);
+		}
+
+		Frame& frame = m_frames[m_writing];
+		DirtyRows& outdated = m_outdated[m_writing];
+		if (frame.scene.size != scene.size || !HasSameLayers(frame.scene, scene))
+		{
+			// Stage has been resized or layers were added or removed since.
+			frame.scene = scene;
+			outdated = DirtyRows(scene.size);
+		}
+		else
+		{
+			Update(frame.scene, scene, outdated);
+			outdated.Reset();
+		}
+		frame.viewport = viewport;
+		frame.flags = flags;
+
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			if (m_fresh)
+			{
+				// The renderer is lagging behind, the previous frame is dropped. Its changes are
+				// not recorded in the dirty rows of this one, so everything must be redrawn.
+				frame.flags |= m_frames[m_ready].flags & Frame::Reconfigure;
+				frame.flags &= ~(Frame::Unchanged | Frame::Partial);
+				frame.scene.background_dirty.MarkAll();
+				for (auto& i: frame.scene.layers)
+					i.second.dirty.MarkAll();
+				m_dropped += 1;
+			}
+			std::swap(m_writing, m_ready);
+			m_fresh = true;
+			m_submitted += 1;
+		}
+		m_wake.notify_all();
+	}
+
+	void RenderThread::Run()
+	{
+		bool acquired = m_window.AcquireRC();
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_state = acquired? kRunning: kFailed;
+		}
+		m_wake.notify_all();
+		if (!acquired)
+			return;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> guard(m_lock);
+				m_wake.wait(guard, [&]{return m_stop || m_fresh;});
+				if (!m_fresh)
+					break; // Stopping, but the latest frame is always drawn first.
+
+				std::swap(m_reading, m_ready);
+				m_fresh = false;
+			}
+
+			m_callback(m_frames[m_reading]);
+		}
+
+		m_window.ReleaseRC();
+	}
+}
@@ -0,0 +1,92 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_RENDERTHREAD_HPP
+#define BEARLIBTERMINAL_RENDERTHREAD_HPP
+
+#include "Renderer.hpp"
+#include "Window.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <array>
+#include <memory>
+#include <cstdint>
+
+namespace BearLibTerminal
+{
+	// Owns the window OpenGL context for its lifetime and draws scenes handed over by
+	// the application thread. Scenes pass through a triple buffer: the producer never
+	// waits for the renderer, and a frame not yet picked up is replaced by a newer one.
+	// Buffers persist between frames: only the cells changed since a buffer was last
+	// written are copied into it.
+	class RenderThread
+	{
+	public:
+		struct Frame
+		{
+			enum
+			{
+				Reconfigure = 0x01, // Viewport differs from the previous frame.
+				ShowGrid    = 0x02,
+				VSync       = 0x04,
+				Unchanged   = 0x08, // Scene and viewport are those of the previous frame.
+				Partial     = 0x10  // Only the cells in the scene dirty rows differ from the previous frame.
+			};
+
+			Frame();
+			Scene scene;
+			Viewport viewport;
+			int flags;
+		};
+
+		typedef std::function<void(const Frame&)> Callback;
+
+		// Returns nullptr if the window cannot hand its context over to another thread.
+		static std::unique_ptr<RenderThread> Create(Window& window, Callback callback);
+		~RenderThread();
+		void Submit(const Scene& scene, const Viewport& viewport, int flags);
+
+	private:
+		RenderThread(Window& window, Callback callback);
+		void Run();
+
+		Window& m_window;
+		Callback m_callback;
+		std::array<Frame, 3> m_frames;
+		std::array<DirtyRows, 3> m_outdated; // Cells changed since each frame was written, owned by the producer.
+		int m_writing;  // Owned by the producer.
+		int m_ready;    // Latest complete frame, exchanged under the lock.
+		int m_reading;  // Owned by the render thread.
+		bool m_fresh;   // m_ready has not been picked up yet.
+		bool m_stop;
+		enum {kStarting, kRunning, kFailed} m_state;
+		uint64_t m_submitted;
+		uint64_t m_dropped;
+		std::mutex m_lock;
+		std::condition_variable m_wake;
+		std::thread m_thread;
+	};
+}
+
+#endif // BEARLIBTERMINAL_RENDERTHREAD_HPP
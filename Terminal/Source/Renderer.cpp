@@ -0,0 +1,186 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Renderer.hpp"
+#include "ImmediateRenderer.hpp"
+#include "BatchedRenderer.hpp"
+#include "SoftwareRenderer.hpp"
+#include "InstancedRenderer.hpp"
+#include "Log.hpp"
+#include <algorithm>
+
+namespace BearLibTerminal
+{
+	Viewport::Viewport():
+		scissors_enabled(false),
+		stage_area_factor(1, 1),
+		replacement_tile(nullptr)
+	{ }
+
+	Rectangle Viewport::GetScissors(Rectangle area) const
+	{
+		Rectangle result = area / stage_area_factor;
+		result.top = scissors.height - (result.top + result.height);
+		result += scissors.Location();
+		return result;
+	}
+
+	Rectangle Viewport::GetLayerScissors(const Layer& layer) const
+	{
+		return GetScissors(layer.crop * cellsize);
+	}
+
+	Rectangle Viewport::ClipScissors(Rectangle scissors) const
+	{
+		return scissors.Intersection(clip);
+	}
+
+	RenderStatistics::RenderStatistics():
+		batches(0),
+		unsorted_batches(0)
+	{ }
+
+	Renderer::~Renderer()
+	{ }
+
+	RenderStatistics Renderer::GetStatistics() const
+	{
+		return RenderStatistics();
+	}
+
+	bool Renderer::IsKnown(const std::wstring& name)
+	{
+		return name == L"immediate" || name == L"batched" || name == L"software" || name == L"instanced";
+	}
+
+	static size_t GetThreadCount(size_t threads)
+	{
+		// Zero stands for one thread per hardware core.
+		return threads > 0? threads: std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	std::unique_ptr<Renderer> Renderer::Create(const std::wstring& name, size_t threads)
+	{
+		threads = GetThreadCount(threads);
+
+		LOG(Info, "Using '" << name << "' renderer, " << threads << " thread(s)");
+
+		if (name == L"immediate")
+			return std::make_unique<ImmediateRenderer>();
+
+		if (name == L"software")
+			return std::make_unique<SoftwareRenderer>(threads);
+
+		if (name == L"instanced")
+			return std::make_unique<InstancedRenderer>();
+
+		return std::make_unique<BatchedRenderer>(threads);
+	}
+
+	std::unique_ptr<SoftwareRenderer> Renderer::CreateOffscreen(size_t threads)
+	{
+		threads = GetThreadCount(threads);
+
+		LOG(Info, "Using software renderer for offscreen output, " << threads << " thread(s)");
+
+		return std::make_unique<SoftwareRenderer>(threads);
+	}
+
+	const TileInfo* LookupTile(const Leaf& leaf, const TileInfo* fallback)
+	{
+		if (leaf.tile_generation != g_tileset_generation)
+		{
+			// Tilesets have changed since the leaf was put.
+			auto tile = g_codespace.Find(leaf.code);
+			if (tile == nullptr)
+				return fallback;
+
+			leaf.tile = tile;
+			leaf.tile_generation = g_tileset_generation;
+		}
+
+		return leaf.tile? leaf.tile: fallback;
+	}
+
+	Size GetTileOverflow(const Scene& scene, const Viewport& viewport, bool changed_only)
+	{
+		const Size& cellsize = viewport.cellsize;
+		auto replacement_tile = viewport.replacement_tile;
+		Size result;
+
+		auto measure = [&](const Layer& layer, int index)
+		{
+			for (auto& leaf: layer.GetLeafs(index))
+			{
+				auto tile = LookupTile(leaf, replacement_tile);
+				Point origin = GetTileOrigin(leaf, *tile, 0, 0);
+				result.width = std::max({result.width, -origin.x, origin.x + tile->useful_space.width - cellsize.width});
+				result.height = std::max({result.height, -origin.y, origin.y + tile->useful_space.height - cellsize.height});
+			}
+		};
+
+		for (auto& slot: scene.layers)
+		{
+			const Layer& layer = slot.second;
+			if (!changed_only)
+			{
+				layer.ForEachOccupied([&](int, int, int index){ measure(layer, index); });
+			}
+			else if (!layer.dirty.IsEmpty() && !layer.IsEmpty())
+			{
+				for (int y = 0; y < layer.size.height; y++)
+				{
+					auto& span = layer.dirty.rows[y];
+					for (int x = span.left; x < span.right; x++)
+						measure(layer, y*layer.size.width + x);
+				}
+			}
+		}
+
+		return result;
+	}
+
+	Rectangle GetDamagedArea(const Scene& scene, const Viewport& viewport, Size overflow)
+	{
+		Rectangle cells = scene.background_dirty.GetBounds();
+		for (auto& slot: scene.layers)
+			cells = cells.Union(slot.second.dirty.GetBounds());
+
+		if (cells.Area() == 0)
+			return Rectangle();
+
+		// One extra pixel around covers the rounding of a scaled stage.
+		Rectangle area = cells * viewport.cellsize;
+		area -= Point(overflow.width + 1, overflow.height + 1);
+		area += Size(overflow.width*2 + 2, overflow.height*2 + 2);
+		Rectangle result = viewport.GetScissors(area);
+		result -= Point(1, 1);
+		result += Size(2, 2);
+		return result.Intersection(viewport.scissors);
+	}
+
+	const TileInfo* PeekTile(const Leaf& leaf, const TileInfo* fallback)
+	{
+		const TileInfo* tile = leaf.tile_generation == g_tileset_generation? leaf.tile: g_codespace.Find(leaf.code);
+		return tile? tile: fallback;
+	}
+}
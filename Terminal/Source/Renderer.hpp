@@ -0,0 +1,95 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_RENDERER_HPP
+#define BEARLIBTERMINAL_RENDERER_HPP
+
+#include "Stage.hpp"
+#include "Size.hpp"
+#include "Rectangle.hpp"
+#include <memory>
+#include <string>
+
+namespace BearLibTerminal
+{
+	struct Viewport
+	{
+		Viewport();
+		Rectangle GetScissors(Rectangle area) const; // Stage pixels to window scissors.
+		Rectangle GetLayerScissors(const Layer& layer) const;
+		Rectangle ClipScissors(Rectangle scissors) const;
+
+		Size stage_size;         // Stage dimensions in cells.
+		Size cellsize;
+		Size half_cellsize;
+		Size window_size;        // Client area in pixels.
+		Rectangle stage_area;    // Scaled stage placement in the client area (top-down).
+		Rectangle scissors;      // Stage area in window coordinates (bottom-up, as glScissor expects).
+		bool scissors_enabled;   // Stage does not cover the whole client area.
+		SizeF stage_area_factor;
+		Rectangle clip;          // Part of the client area being drawn (bottom-up), the rest is kept from the previous frame.
+		const TileInfo* replacement_tile; // Resolved by the application thread, renderers must not add tiles themselves.
+	};
+
+	// Draw call counts of the last frame, for timing reports. Renderers that do not
+	// count them report zeroes.
+	struct RenderStatistics
+	{
+		RenderStatistics();
+		size_t batches;          // Texture batches drawn.
+		size_t unsorted_batches; // Batches the same frame would take in leaf order.
+	};
+
+	class SoftwareRenderer;
+
+	class Renderer
+	{
+	public:
+		virtual ~Renderer();
+		virtual void Draw(const Scene& scene, const Viewport& viewport) = 0;
+		virtual RenderStatistics GetStatistics() const;
+		static bool IsKnown(const std::wstring& name);
+		static std::unique_ptr<Renderer> Create(const std::wstring& name, size_t threads);
+		static std::unique_ptr<SoftwareRenderer> CreateOffscreen(size_t threads); // For the headless window.
+	};
+
+	// Top-left corner of the tile quad for a leaf in the cell at (x, y) pixels.
+	inline Point GetTileOrigin(const Leaf& leaf, const TileInfo& tile, int x, int y)
+	{
+		return Point(x + tile.quad.left + leaf.dx, y + tile.quad.top + leaf.dy);
+	}
+
+	const TileInfo* LookupTile(const Leaf& leaf, const TileInfo* fallback);
+
+	// How far tiles spill over the borders of their cells, in pixels. With changed_only
+	// set, only the cells marked in the layer dirty rows are looked at.
+	Size GetTileOverflow(const Scene& scene, const Viewport& viewport, bool changed_only);
+
+	// Window scissors enclosing everything drawn in the changed cells, assuming no tile
+	// spills over its cell by more than overflow.
+	Rectangle GetDamagedArea(const Scene& scene, const Viewport& viewport, Size overflow);
+
+	// Same as LookupTile but never updates the leaf, so it is safe to call from several threads.
+	const TileInfo* PeekTile(const Leaf& leaf, const TileInfo* fallback);
+}
+
+#endif // BEARLIBTERMINAL_RENDERER_HPP
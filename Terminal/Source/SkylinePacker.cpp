@@ -0,0 +1,261 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "SkylinePacker.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace BearLibTerminal
+{
+	SkylinePacker::SkylinePacker():
+		m_used_area(0)
+	{ }
+
+	SkylinePacker::SkylinePacker(Size size):
+		m_size(size),
+		m_used_area(0)
+	{
+		if (size.width > 0)
+			m_skyline.push_back(Segment{0, 0, size.width});
+	}
+
+	bool SkylinePacker::Insert(Size size, Point& location)
+	{
+		if (size.width <= 0 || size.height <= 0)
+			return false;
+
+		if (!InsertFree(size, location) && !InsertSkyline(size, location))
+			return false;
+
+		m_used_area += size.Area();
+		return true;
+	}
+
+	bool SkylinePacker::InsertFree(Size size, Point& location)
+	{
+		// Best short side fit.
+		auto best = m_free.end();
+		int best_fit = std::numeric_limits<int>::max();
+		for (auto i = m_free.begin(); i != m_free.end(); ++i)
+		{
+			if (i->width < size.width || i->height < size.height)
+				continue;
+
+			int fit = std::min(i->width - size.width, i->height - size.height);
+			if (fit < best_fit)
+			{
+				best = i;
+				best_fit = fit;
+				if (fit == 0)
+					break;
+			}
+		}
+
+		if (best == m_free.end())
+			return false;
+
+		Rectangle space = *best;
+		*best = m_free.back();
+		m_free.pop_back();
+		location = space.Location();
+
+		// Split the rest so that the bigger leftover stays as large as possible.
+		int right = space.width - size.width;
+		int bottom = space.height - size.height;
+		if (right * space.height > bottom * space.width)
+		{
+			AddFree(Rectangle{space.left + size.width, space.top, right, space.height});
+			AddFree(Rectangle{space.left, space.top + size.height, size.width, bottom});
+		}
+		else
+		{
+			AddFree(Rectangle{space.left + size.width, space.top, right, size.height});
+			AddFree(Rectangle{space.left, space.top + size.height, space.width, bottom});
+		}
+
+		return true;
+	}
+
+	int SkylinePacker::FitSkyline(size_t index, Size size) const
+	{
+		// Returns the top coordinate a rectangle would rest at, or -1 if it does not fit.
+		int left = m_skyline[index].left;
+		if (left + size.width > m_size.width)
+			return -1;
+
+		int top = 0;
+		for (int remaining = size.width; remaining > 0; remaining -= m_skyline[index++].width)
+		{
+			top = std::max(top, m_skyline[index].top);
+			if (top + size.height > m_size.height)
+				return -1;
+		}
+
+		return top;
+	}
+
+	bool SkylinePacker::InsertSkyline(Size size, Point& location)
+	{
+		// Bottom-left: the lowest resulting bottom edge, leftmost on ties.
+		size_t best = m_skyline.size();
+		int best_top = 0;
+		for (size_t i = 0; i < m_skyline.size(); i++)
+		{
+			int top = FitSkyline(i, size);
+			if (top >= 0 && (best == m_skyline.size() || top < best_top))
+			{
+				best = i;
+				best_top = top;
+			}
+		}
+
+		if (best == m_skyline.size())
+			return false;
+
+		int left = m_skyline[best].left;
+		int right = left + size.width;
+		location = Point{left, best_top};
+
+		// Space under the rectangle above lower segments is not lost but goes to the free list.
+		for (size_t i = best; i < m_skyline.size() && m_skyline[i].left < right; i++)
+		{
+			const Segment& s = m_skyline[i];
+			if (s.top < best_top)
+			{
+				int span = std::min(s.left + s.width, right) - s.left;
+				AddFree(Rectangle{s.left, s.top, span, best_top - s.top});
+			}
+		}
+
+		// Raise the skyline.
+		m_skyline.insert(m_skyline.begin() + best, Segment{left, best_top + size.height, size.width});
+		for (size_t i = best + 1; i < m_skyline.size() && m_skyline[i].left < right; )
+		{
+			Segment& s = m_skyline[i];
+			int overlap = right - s.left;
+			if (overlap >= s.width)
+			{
+				m_skyline.erase(m_skyline.begin() + i);
+			}
+			else
+			{
+				s.left += overlap;
+				s.width -= overlap;
+				break;
+			}
+		}
+
+		// Join neighbouring segments of the same height.
+		for (size_t i = 1; i < m_skyline.size(); )
+		{
+			if (m_skyline[i-1].top == m_skyline[i].top)
+			{
+				m_skyline[i-1].width += m_skyline[i].width;
+				m_skyline.erase(m_skyline.begin() + i);
+			}
+			else
+			{
+				i += 1;
+			}
+		}
+
+		return true;
+	}
+
+	void SkylinePacker::AddFree(Rectangle area)
+	{
+		if (area.width <= 0 || area.height <= 0)
+			return;
+
+		// Merge with any free rectangle sharing a whole edge, repeat while the result grows.
+		for (size_t i = 0; i < m_free.size(); )
+		{
+			const Rectangle& r = m_free[i];
+			bool merged = false;
+
+			if (r.top == area.top && r.height == area.height)
+			{
+				if (r.left + r.width == area.left || area.left + area.width == r.left)
+				{
+					area.left = std::min(area.left, r.left);
+					area.width += r.width;
+					merged = true;
+				}
+			}
+			else if (r.left == area.left && r.width == area.width)
+			{
+				if (r.top + r.height == area.top || area.top + area.height == r.top)
+				{
+					area.top = std::min(area.top, r.top);
+					area.height += r.height;
+					merged = true;
+				}
+			}
+
+			if (merged)
+			{
+				m_free[i] = m_free.back();
+				m_free.pop_back();
+				i = 0;
+			}
+			else
+			{
+				i += 1;
+			}
+		}
+
+		m_free.push_back(area);
+	}
+
+	void SkylinePacker::Release(Rectangle area)
+	{
+		if (area.width <= 0 || area.height <= 0)
+			return;
+
+		m_used_area -= area.Area();
+		AddFree(area);
+	}
+
+	void SkylinePacker::Grow(Size size)
+	{
+		if (size.width > m_size.width)
+		{
+			if (!m_skyline.empty() && m_skyline.back().top == 0)
+				m_skyline.back().width += size.width - m_size.width;
+			else
+				m_skyline.push_back(Segment{m_size.width, 0, size.width - m_size.width});
+		}
+
+		m_size.width = std::max(m_size.width, size.width);
+		m_size.height = std::max(m_size.height, size.height);
+	}
+
+	Size SkylinePacker::GetSize() const
+	{
+		return m_size;
+	}
+
+	int SkylinePacker::GetUsedArea() const
+	{
+		return m_used_area;
+	}
+}
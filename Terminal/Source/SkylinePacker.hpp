@@ -0,0 +1,73 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_SKYLINEPACKER_HPP
+#define BEARLIBTERMINAL_SKYLINEPACKER_HPP
+
+#include "Point.hpp"
+#include "Size.hpp"
+#include "Rectangle.hpp"
+#include <vector>
+
+namespace BearLibTerminal
+{
+	// Rectangle packer for atlas textures. New rectangles are placed bottom-left
+	// onto a skyline (the lowest occupied row of every column span). Gaps left
+	// under a placed rectangle and rectangles given back via Release go into
+	// a free list where neighbouring ones are merged and reused first.
+	class SkylinePacker
+	{
+	public:
+		SkylinePacker();
+		SkylinePacker(Size size);
+
+		// Places a rectangle, returns false if it does not fit into the current size.
+		bool Insert(Size size, Point& location);
+
+		// Returns a previously inserted rectangle to the free space.
+		void Release(Rectangle area);
+
+		// Enlarges the packing area, existing placements stay where they are.
+		void Grow(Size size);
+
+		Size GetSize() const;
+		int GetUsedArea() const;
+
+	private:
+		struct Segment
+		{
+			int left, top, width;
+		};
+
+		bool InsertFree(Size size, Point& location);
+		bool InsertSkyline(Size size, Point& location);
+		int FitSkyline(size_t index, Size size) const;
+		void AddFree(Rectangle area);
+
+		Size m_size;
+		int m_used_area;
+		std::vector<Segment> m_skyline;
+		std::vector<Rectangle> m_free;
+	};
+}
+
+#endif // BEARLIBTERMINAL_SKYLINEPACKER_HPP
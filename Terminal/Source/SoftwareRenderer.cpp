@@ -0,0 +1,349 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "SoftwareRenderer.hpp"
+#include "OpenGL.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BEARLIBTERMINAL_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace BearLibTerminal
+{
+	// Bands thinner than this are not worth a thread.
+	static const int kMinBandHeight = 32;
+
+	// x/255 rounded to nearest, exact for x in [0, 255*255].
+	static inline uint32_t Div255(uint32_t x)
+	{
+		x += 128;
+		return (x + (x >> 8)) >> 8;
+	}
+
+	static inline Color Modulate(Color texel, Color color)
+	{
+		return Color(Div255(texel.a*color.a), Div255(texel.r*color.r), Div255(texel.g*color.g), Div255(texel.b*color.b));
+	}
+
+	// Same as glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), alpha channel included.
+	static inline void BlendPixel(Color& dst, Color src)
+	{
+		uint32_t a = src.a, ia = 255 - a;
+		dst.b = Div255(src.b*a + dst.b*ia);
+		dst.g = Div255(src.g*a + dst.g*ia);
+		dst.r = Div255(src.r*a + dst.r*ia);
+		dst.a = Div255(src.a*a + dst.a*ia);
+	}
+
+#if defined(BEARLIBTERMINAL_SSE2)
+	// Operates on two pixels unpacked to 16 bit per channel.
+	static inline __m128i Div255(__m128i x)
+	{
+		x = _mm_add_epi16(x, _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+	}
+
+	static inline __m128i BlendPixels(__m128i src, __m128i dst)
+	{
+		__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+		return Div255(_mm_add_epi16(_mm_mullo_epi16(src, alpha), _mm_mullo_epi16(dst, inverse)));
+	}
+#endif
+
+	// dst[i] = blend(dst[i], src[i] * color)
+	static void BlendSpan(Color* dst, const Color* src, int count, Color color)
+	{
+		int i = 0;
+#if defined(BEARLIBTERMINAL_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i modulate = _mm_unpacklo_epi8(_mm_set1_epi32((uint32_t)color), zero);
+		for (; i+4 <= count; i += 4)
+		{
+			__m128i s = _mm_loadu_si128((const __m128i*)(src+i));
+			__m128i d = _mm_loadu_si128((const __m128i*)(dst+i));
+			__m128i lo = Div255(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), modulate));
+			__m128i hi = Div255(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), modulate));
+			lo = BlendPixels(lo, _mm_unpacklo_epi8(d, zero));
+			hi = BlendPixels(hi, _mm_unpackhi_epi8(d, zero));
+			_mm_storeu_si128((__m128i*)(dst+i), _mm_packus_epi16(lo, hi));
+		}
+#endif
+		for (; i < count; i++)
+			BlendPixel(dst[i], Modulate(src[i], color));
+	}
+
+	// dst[i] = blend(dst[i], color)
+	static void BlendFill(Color* dst, int count, Color color)
+	{
+		int i = 0;
+#if defined(BEARLIBTERMINAL_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32((uint32_t)color), zero);
+		for (; i+4 <= count; i += 4)
+		{
+			__m128i d = _mm_loadu_si128((const __m128i*)(dst+i));
+			__m128i lo = BlendPixels(src, _mm_unpacklo_epi8(d, zero));
+			__m128i hi = BlendPixels(src, _mm_unpackhi_epi8(d, zero));
+			_mm_storeu_si128((__m128i*)(dst+i), _mm_packus_epi16(lo, hi));
+		}
+#endif
+		for (; i < count; i++)
+			BlendPixel(dst[i], color);
+	}
+
+	struct RasterVertex
+	{
+		int x, y;
+		float u, v;
+		Color color;
+	};
+
+	// Twice the signed area of (a, b, p), with p given in doubled coordinates.
+	static inline int64_t EdgeFunction(const RasterVertex& a, const RasterVertex& b, int64_t px, int64_t py)
+	{
+		return (int64_t)(b.x-a.x)*(py-2*a.y) - (int64_t)(b.y-a.y)*(px-2*a.x);
+	}
+
+	// Pixels exactly on an edge shared by two triangles must be drawn by only one of them.
+	static inline bool OwnsEdge(const RasterVertex& a, const RasterVertex& b)
+	{
+		return (b.y > a.y) || (b.y == a.y && b.x < a.x);
+	}
+
+	// Gouraud-shaded, nearest-sampled, textured triangle; used for corner-colored leafs
+	// where the four corner colors are interpolated the way OpenGL does it.
+	static void RasterizeTriangle(Bitmap& target, Rectangle clip, const Bitmap& canvas, RasterVertex v0, RasterVertex v1, RasterVertex v2)
+	{
+		int64_t area = (int64_t)(v1.x-v0.x)*(v2.y-v0.y) - (int64_t)(v1.y-v0.y)*(v2.x-v0.x);
+		if (area == 0)
+			return;
+		if (area < 0)
+		{
+			std::swap(v1, v2);
+			area = -area;
+		}
+
+		int left = std::max(clip.left, std::min({v0.x, v1.x, v2.x}));
+		int right = std::min(clip.left + clip.width, std::max({v0.x, v1.x, v2.x}));
+		int top = std::max(clip.top, std::min({v0.y, v1.y, v2.y}));
+		int bottom = std::min(clip.top + clip.height, std::max({v0.y, v1.y, v2.y}));
+
+		bool owns0 = OwnsEdge(v1, v2), owns1 = OwnsEdge(v2, v0), owns2 = OwnsEdge(v0, v1);
+		Size canvas_size = canvas.GetSize();
+		double scale = 1.0 / (2*area);
+
+		for (int y = top; y < bottom; y++)
+		{
+			Color* row = &target(0, y);
+			for (int x = left; x < right; x++)
+			{
+				// Pixel centers, in doubled coordinates to stay in integers.
+				int64_t px = 2*x+1, py = 2*y+1;
+				int64_t e0 = EdgeFunction(v1, v2, px, py);
+				int64_t e1 = EdgeFunction(v2, v0, px, py);
+				int64_t e2 = EdgeFunction(v0, v1, px, py);
+				if (e0 < 0 || e1 < 0 || e2 < 0 || (e0 == 0 && !owns0) || (e1 == 0 && !owns1) || (e2 == 0 && !owns2))
+					continue;
+
+				double b0 = e0*scale, b1 = e1*scale, b2 = e2*scale;
+				double u = b0*v0.u + b1*v1.u + b2*v2.u;
+				double v = b0*v0.v + b1*v1.v + b2*v2.v;
+				int tx = (int)std::floor(u*canvas_size.width) % canvas_size.width;
+				int ty = (int)std::floor(v*canvas_size.height) % canvas_size.height;
+				if (tx < 0) tx += canvas_size.width;
+				if (ty < 0) ty += canvas_size.height;
+				const Color& texel = canvas(tx, ty);
+
+				auto channel = [&](uint8_t c0, uint8_t c1, uint8_t c2, uint8_t t) -> float
+				{
+					return float((b0*c0 + b1*c1 + b2*c2) * t / (255.0*255.0));
+				};
+				float sb = channel(v0.color.b, v1.color.b, v2.color.b, texel.b);
+				float sg = channel(v0.color.g, v1.color.g, v2.color.g, texel.g);
+				float sr = channel(v0.color.r, v1.color.r, v2.color.r, texel.r);
+				float sa = channel(v0.color.a, v1.color.a, v2.color.a, texel.a);
+
+				Color& d = row[x];
+				d.b = (uint8_t)std::lround((sb*sa + d.b/255.0f*(1-sa)) * 255);
+				d.g = (uint8_t)std::lround((sg*sa + d.g/255.0f*(1-sa)) * 255);
+				d.r = (uint8_t)std::lround((sr*sa + d.r/255.0f*(1-sa)) * 255);
+				d.a = (uint8_t)std::lround((sa*sa + d.a/255.0f*(1-sa)) * 255);
+			}
+		}
+	}
+
+	SoftwareRenderer::SoftwareRenderer(size_t threads):
+		m_pool(std::max<size_t>(threads, 1))
+	{ }
+
+	void SoftwareRenderer::Draw(const Scene& scene, const Viewport& viewport)
+	{
+		Size size = viewport.stage_size * viewport.cellsize;
+		Size texture_size = size;
+		if (!g_has_texture_npot)
+		{
+			texture_size.width = RoundUpToPow2(size.width);
+			texture_size.height = RoundUpToPow2(size.height);
+		}
+
+		if (m_frame.GetSize() != texture_size)
+			m_frame = Bitmap(texture_size, Color());
+
+		Render(scene, viewport, m_frame);
+		m_texture.Update(m_frame);
+
+		// Frame already has everything blended in.
+		float u = size.width / (float)texture_size.width;
+		float v = size.height / (float)texture_size.height;
+		glDisable(GL_BLEND);
+		Texture::Enable();
+		m_texture.Bind();
+		glColor4f(1, 1, 1, 1);
+		glBegin(GL_QUADS);
+		glTexCoord2f(0, 0);
+		glVertex2i(0, 0);
+		glTexCoord2f(0, v);
+		glVertex2i(0, size.height);
+		glTexCoord2f(u, v);
+		glVertex2i(size.width, size.height);
+		glTexCoord2f(u, 0);
+		glVertex2i(size.width, 0);
+		glEnd();
+		glEnable(GL_BLEND);
+	}
+
+	void SoftwareRenderer::Render(const Scene& scene, const Viewport& viewport, Bitmap& target)
+	{
+		Size size = viewport.stage_size * viewport.cellsize;
+		auto replacement_tile = viewport.replacement_tile;
+
+		size_t bands = std::min<size_t>(m_pool.GetConcurrency(), std::max(1, size.height / kMinBandHeight));
+		m_pool.Run(bands, [&](size_t i)
+		{
+			int top = (int)(size.height * i / bands);
+			int bottom = (int)(size.height * (i+1) / bands);
+			RenderBand(scene, viewport, target, replacement_tile, Rectangle(0, top, size.width, bottom-top));
+		});
+	}
+
+	void SoftwareRenderer::RenderBand(const Scene& scene, const Viewport& viewport, Bitmap& target, const TileInfo* replacement_tile, Rectangle band)
+	{
+		int w = viewport.cellsize.width;
+		int h = viewport.cellsize.height;
+
+		// Same as glClear with the black clear color.
+		for (int y = band.top; y < band.top + band.height; y++)
+			std::fill_n(&target(band.left, y), band.width, Color(255, 0, 0, 0));
+
+		// Backgrounds
+		int first_row = band.top / h;
+		int last_row = std::min(viewport.stage_size.height, (band.top + band.height + h - 1) / h);
+		for (int y = first_row; y < last_row; y++)
+		{
+			int top = std::max(y*h, band.top);
+			int bottom = std::min((y+1)*h, band.top + band.height);
+			for (int x = 0, i = y*viewport.stage_size.width; x < viewport.stage_size.width; x++, i++)
+			{
+				const Color& c = scene.background[i];
+				if (c.a == 0)
+					continue;
+
+				for (int py = top; py < bottom; py++)
+					BlendFill(&target(x*w, py), w, c);
+			}
+		}
+
+		// Layers
+		for (auto& slot: scene.layers)
+		{
+			const Layer& layer = slot.second;
+			if (layer.IsEmpty())
+				continue;
+
+			Rectangle clip = band;
+			if (layer.crop.Area() > 0)
+				clip = clip.Intersection(layer.crop * viewport.cellsize);
+			if (clip.width <= 0 || clip.height <= 0)
+				continue;
+
+			layer.ForEachOccupied([&](int x, int y, int i)
+			{
+				for (auto& leaf: layer.GetLeafs(i))
+				{
+					auto tile = PeekTile(leaf, replacement_tile);
+					DrawTile(target, clip, leaf, *tile, x*w, y*h);
+				}
+			});
+		}
+	}
+
+	void SoftwareRenderer::DrawTile(Bitmap& target, Rectangle clip, const Leaf& leaf, const TileInfo& tile, int x, int y)
+	{
+		if (tile.texture == nullptr)
+			return;
+
+		const Bitmap& canvas = tile.texture->GetCanvas();
+		Point origin = GetTileOrigin(leaf, tile, x, y);
+		Rectangle quad(origin, tile.useful_space.Size());
+
+		if (leaf.flags & Leaf::CornerColored)
+		{
+			// Same 2-quad (4-triangle) layout as the OpenGL renderers.
+			const Color* c = leaf.color;
+			const TexCoords& tc = tile.texture_coords;
+			int left = quad.left, top = quad.top;
+			int right = left + quad.width, bottom = top + quad.height;
+			Color center
+			(
+				(c[0].a + c[1].a + c[2].a + c[3].a)/4,
+				(c[0].r + c[1].r + c[2].r + c[3].r)/4,
+				(c[0].g + c[1].g + c[2].g + c[3].g)/4,
+				(c[0].b + c[1].b + c[2].b + c[3].b)/4
+			);
+			RasterVertex top_left{left, top, tc.tu1, tc.tv1, c[0]};
+			RasterVertex bottom_left{left, bottom, tc.tu1, tc.tv2, c[1]};
+			RasterVertex bottom_right{right, bottom, tc.tu2, tc.tv2, c[2]};
+			RasterVertex top_right{right, top, tc.tu2, tc.tv1, c[3]};
+			RasterVertex middle{(int)((left + right)/2.0f), (int)((top + bottom)/2.0f), (tc.tu1 + tc.tu2)/2.0f, (tc.tv1 + tc.tv2)/2.0f, center};
+
+			RasterizeTriangle(target, clip, canvas, top_left, bottom_left, middle);
+			RasterizeTriangle(target, clip, canvas, top_left, middle, top_right);
+			RasterizeTriangle(target, clip, canvas, bottom_right, top_right, middle);
+			RasterizeTriangle(target, clip, canvas, bottom_right, middle, bottom_left);
+		}
+		else
+		{
+			Rectangle area = clip.Intersection(quad);
+			if (area.width <= 0 || area.height <= 0)
+				return;
+
+			int u = tile.useful_space.left + area.left - quad.left;
+			int v = tile.useful_space.top + area.top - quad.top;
+			for (int i = 0; i < area.height; i++)
+				BlendSpan(&target(area.left, area.top + i), &canvas(u, v + i), area.width, leaf.color[0]);
+		}
+	}
+}
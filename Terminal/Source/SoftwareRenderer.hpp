@@ -0,0 +1,56 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_SOFTWARERENDERER_HPP
+#define BEARLIBTERMINAL_SOFTWARERENDERER_HPP
+
+#include "Renderer.hpp"
+#include "ThreadPool.hpp"
+#include "Bitmap.hpp"
+#include "Texture.hpp"
+#include <memory>
+
+namespace BearLibTerminal
+{
+	// Composites the scene on the CPU, reading tiles straight from atlas canvases.
+	// Render does not touch OpenGL at all; Draw uploads the result as a single texture.
+	class SoftwareRenderer: public Renderer
+	{
+	public:
+		SoftwareRenderer(size_t threads);
+		void Draw(const Scene& scene, const Viewport& viewport);
+
+		// Renders the stage at 1:1 scale into the top-left corner of the target,
+		// which must be at least stage_size*cellsize pixels large.
+		void Render(const Scene& scene, const Viewport& viewport, Bitmap& target);
+
+	private:
+		void RenderBand(const Scene& scene, const Viewport& viewport, Bitmap& target, const TileInfo* replacement_tile, Rectangle band);
+		void DrawTile(Bitmap& target, Rectangle clip, const Leaf& leaf, const TileInfo& tile, int x, int y);
+
+		ThreadPool m_pool;
+		Bitmap m_frame;
+		Texture m_texture;
+	};
+}
+
+#endif // BEARLIBTERMINAL_SOFTWARERENDERER_HPP
@@ -22,6 +22,7 @@
 
 #include "Stage.hpp"
 #include "BearLibTerminal.h"
+#include <algorithm>
 
 namespace BearLibTerminal
 {
@@ -30,36 +31,422 @@ namespace BearLibTerminal
 		dy(0),
 		code(0),
 		flags(0),
-		reserved(0)
+		reserved(0),
+		tile(nullptr),
+		tile_generation(0)
 	{ }
 
+	bool Leaf::operator==(const Leaf& other) const
+	{
+		return
+			code == other.code &&
+			dx == other.dx &&
+			dy == other.dy &&
+			flags == other.flags &&
+			color[0] == other.color[0] &&
+			(!(flags & CornerColored) ||
+			 (color[1] == other.color[1] && color[2] == other.color[2] && color[3] == other.color[3]));
+	}
+
+	bool Leaf::operator!=(const Leaf& other) const
+	{
+		return !(*this == other);
+	}
+
+	Cell::Cell():
+		offset(0),
+		count(0),
+		capacity(0),
+		generation(0)
+	{ }
+
+	DirtyRows::Span::Span():
+		left(0),
+		right(0)
+	{ }
+
+	bool DirtyRows::Span::IsEmpty() const
+	{
+		return left >= right;
+	}
+
+	DirtyRows::DirtyRows():
+		width(0),
+		empty(true)
+	{ }
+
+	DirtyRows::DirtyRows(Size size):
+		rows(size.height),
+		width(size.width),
+		empty(true)
+	{ }
+
+	void DirtyRows::Mark(int x, int y)
+	{
+		Span& span = rows[y];
+		if (span.IsEmpty())
+		{
+			span.left = x;
+			span.right = x+1;
+		}
+		else
+		{
+			if (x < span.left) span.left = x;
+			if (x >= span.right) span.right = x+1;
+		}
+		empty = false;
+	}
+
+	void DirtyRows::Mark(Rectangle area)
+	{
+		area = Rectangle(Size(width, (int)rows.size())).Intersection(area);
+		if (area.width <= 0 || area.height <= 0)
+			return;
+
+		for (int y = area.top; y < area.top + area.height; y++)
+		{
+			Span& span = rows[y];
+			if (span.IsEmpty())
+			{
+				span.left = area.left;
+				span.right = area.left + area.width;
+			}
+			else
+			{
+				span.left = std::min(span.left, area.left);
+				span.right = std::max(span.right, area.left + area.width);
+			}
+		}
+		empty = false;
+	}
+
+	void DirtyRows::MarkAll()
+	{
+		for (auto& span: rows)
+		{
+			span.left = 0;
+			span.right = width;
+		}
+		empty = rows.empty() || width == 0;
+	}
+
+	void DirtyRows::Reset()
+	{
+		if (empty)
+			return;
+
+		for (auto& span: rows)
+			span = Span();
+		empty = true;
+	}
+
+	bool DirtyRows::IsEmpty() const
+	{
+		return empty;
+	}
+
+	Rectangle DirtyRows::GetBounds() const
+	{
+		int left = width, top = (int)rows.size(), right = 0, bottom = 0;
+		if (!empty)
+		{
+			for (int y = 0; y < (int)rows.size(); y++)
+			{
+				const Span& span = rows[y];
+				if (span.IsEmpty())
+					continue;
+
+				left = std::min(left, span.left);
+				right = std::max(right, span.right);
+				top = std::min(top, y);
+				bottom = y+1;
+			}
+		}
+		return left < right? Rectangle(left, top, right-left, bottom-top): Rectangle();
+	}
+
 	Layer::Layer(Size size):
-		cells(size.Area())
+		size(size),
+		cells(size.Area()),
+		garbage(0),
+		generation(0),
+		empty(true),
+		row_words((size.width + 63) / 64),
+		occupancy(row_words * size.height),
+		dirty(size)
 	{ }
 
+	Range<Leaf> Layer::GetLeafs(int index)
+	{
+		const Cell& cell = cells[index];
+		Leaf* first = arena.data() + cell.offset;
+		return Range<Leaf>(first, first + (cell.generation == generation? cell.count: 0));
+	}
+
+	Range<const Leaf> Layer::GetLeafs(int index) const
+	{
+		const Cell& cell = cells[index];
+		const Leaf* first = arena.data() + cell.offset;
+		return Range<const Leaf>(first, first + (cell.generation == generation? cell.count: 0));
+	}
+
+	Cell& Layer::Touch(int index)
+	{
+		Cell& cell = cells[index];
+		if (cell.generation != generation)
+		{
+			// Cleared since last written; the slot itself is still owned by the cell.
+			cell.count = 0;
+			cell.generation = generation;
+		}
+		return cell;
+	}
+
+	void Layer::SetOccupied(int index, bool occupied)
+	{
+		int y = index / size.width, x = index % size.width;
+		uint64_t& word = occupancy[y*row_words + x/64];
+		uint64_t bit = uint64_t(1) << (x % 64);
+		if (occupied)
+			word |= bit;
+		else
+			word &= ~bit;
+	}
+
+	Leaf* Layer::Reserve(Cell& cell, size_t count)
+	{
+		if (count > cell.capacity)
+		{
+			// Abandoned slots are only reclaimed when they make up most of the arena.
+			if (garbage > 4096 && garbage > arena.size()/2)
+				Compact();
+
+			size_t capacity = std::min<size_t>(std::max<size_t>(count, cell.capacity*2), 0xFFFF);
+			size_t offset = arena.size();
+			arena.resize(offset + capacity);
+			std::copy(arena.begin() + cell.offset, arena.begin() + cell.offset + cell.count, arena.begin() + offset);
+			garbage += cell.capacity;
+			cell.offset = (uint32_t)offset;
+			cell.capacity = (uint16_t)capacity;
+		}
+
+		return arena.data() + cell.offset;
+	}
+
+	Leaf& Layer::Append(int index)
+	{
+		Cell& cell = Touch(index);
+		if (cell.count == 0xFFFF)
+		{
+			// Absurdly deep stack, reuse the topmost leaf.
+			cell.count -= 1;
+		}
+
+		Leaf* leafs = Reserve(cell, cell.count + 1);
+		Leaf& leaf = leafs[cell.count++];
+		leaf = Leaf();
+		if (cell.count == 1) SetOccupied(index, true);
+		empty = false;
+		return leaf;
+	}
+
+	void Layer::Erase(int index)
+	{
+		// Slot capacity is kept for whatever is put here next.
+		Touch(index).count = 0;
+		if (!empty) SetOccupied(index, false);
+	}
+
+	void Layer::Assign(int index, Range<const Leaf> leafs)
+	{
+		Cell& cell = Touch(index);
+		size_t count = std::min<size_t>(leafs.size(), 0xFFFF);
+		Leaf* first = Reserve(cell, count);
+		std::copy(leafs.begin(), leafs.begin() + count, first);
+		cell.count = (uint16_t)count;
+		SetOccupied(index, count > 0);
+		if (count > 0) empty = false;
+	}
+
+	void Layer::Clear()
+	{
+		// Every cell stamped with the previous generation becomes empty at once.
+		empty = true;
+		std::fill(occupancy.begin(), occupancy.end(), 0);
+		if (++generation == 0)
+		{
+			std::fill(cells.begin(), cells.end(), Cell());
+			arena.clear();
+			garbage = 0;
+		}
+	}
+
+	void Layer::Compact()
+	{
+		std::vector<Leaf> compacted;
+		compacted.reserve(arena.size() - garbage);
+		for (auto& cell: cells)
+		{
+			if (cell.generation != generation)
+			{
+				cell.count = 0;
+				cell.generation = generation;
+			}
+
+			size_t offset = compacted.size();
+			compacted.insert(compacted.end(), arena.begin() + cell.offset, arena.begin() + cell.offset + cell.count);
+			cell.offset = (uint32_t)offset;
+			cell.capacity = cell.count;
+		}
+		arena.swap(compacted);
+		garbage = 0;
+	}
+
+	bool Layer::IsEmpty() const
+	{
+		return empty;
+	}
+
+	Layer* Scene::FindLayer(int index)
+	{
+		auto i = layers.find(index);
+		return i != layers.end()? &i->second: nullptr;
+	}
+
 	void Stage::Resize(Size new_size)
 	{
 		size = new_size;
+		backbuffer.size = size;
 
 		// Background: reset to transparent
 		backbuffer.background = std::vector<Color>(size.Area());
+		backbuffer.background_dirty = DirtyRows(size);
+		backbuffer.background_dirty.MarkAll();
+
+		// Layers will be allocated again once something is put there.
+		backbuffer.layers.clear();
+	}
+
+	Layer& Stage::AcquireLayer(int index)
+	{
+		auto i = backbuffer.layers.find(index);
+		if (i == backbuffer.layers.end())
+			i = backbuffer.layers.emplace(index, Layer(size)).first;
+		return i->second;
+	}
 
-		if (backbuffer.layers.empty())
+	bool Stage::Present()
+	{
+		Scene& front = frontbuffer;
+		Scene& back = backbuffer;
+
+		if (front.size != back.size)
 		{
-			// Scene must have at least one layer
-			backbuffer.layers.emplace_back(size);
+			// Stage has been resized, nothing to compare against.
+			front = back;
+			front.background_dirty.MarkAll();
+			back.background_dirty.Reset();
+			for (auto& i: front.layers)
+				i.second.dirty.MarkAll();
+			for (auto& i: back.layers)
+				i.second.dirty.Reset();
+			return true;
 		}
-		else
+
+		// Only the cells marked as modified are compared and copied. The frontbuffer
+		// dirty rows then hold exactly the cells that differ from the previous frame.
+		front.background_dirty.Reset();
+		if (!back.background_dirty.IsEmpty())
+		{
+			for (int y = 0; y < size.height; y++)
+			{
+				auto& span = back.background_dirty.rows[y];
+				for (int x = span.left, i = y*size.width+span.left; x < span.right; x++, i++)
+				{
+					if (front.background[i] != back.background[i])
+					{
+						front.background[i] = back.background[i];
+						front.background_dirty.Mark(x, y);
+					}
+				}
+			}
+			back.background_dirty.Reset();
+		}
+
+		for (auto& i: front.layers)
 		{
-			// Must preserve number of layers since who knows what layer is currently selected
-			for (auto& i: backbuffer.layers) i = Layer(size);
+			Layer& front_layer = i.second;
+			front_layer.dirty.Reset();
+			if (!front_layer.IsEmpty() && !back.FindLayer(i.first))
+			{
+				// Backbuffer layer is gone altogether.
+				front_layer.Clear();
+				front_layer.dirty.MarkAll();
+			}
 		}
 
-		// TODO: unnecessary?
-		if (frontbuffer.background.size() != backbuffer.background.size())
+		for (auto& i: back.layers)
 		{
-			frontbuffer = backbuffer;
+			Layer& back_layer = i.second;
+			Layer* front_layer_ptr = front.FindLayer(i.first);
+			if (!front_layer_ptr)
+			{
+				if (back_layer.IsEmpty())
+				{
+					back_layer.dirty.Reset();
+					continue;
+				}
+
+				front_layer_ptr = &front.layers.emplace(i.first, Layer(size)).first->second;
+			}
+			Layer& front_layer = *front_layer_ptr;
+
+			const Rectangle& a = front_layer.crop;
+			const Rectangle& b = back_layer.crop;
+			if (a.left != b.left || a.top != b.top || a.width != b.width || a.height != b.height)
+			{
+				// Crop affects the whole layer.
+				front_layer.crop = back_layer.crop;
+				front_layer.dirty.MarkAll();
+			}
+
+			if (back_layer.IsEmpty())
+			{
+				// Nothing to compare cell by cell.
+				if (!front_layer.IsEmpty())
+				{
+					front_layer.Clear();
+					front_layer.dirty.MarkAll();
+				}
+				back_layer.dirty.Reset();
+				continue;
+			}
+
+			if (back_layer.dirty.IsEmpty())
+				continue;
+
+			for (int y = 0; y < size.height; y++)
+			{
+				auto& span = back_layer.dirty.rows[y];
+				for (int x = span.left, i = y*size.width+span.left; x < span.right; x++, i++)
+				{
+					auto front_leafs = front_layer.GetLeafs(i);
+					auto back_leafs = back_layer.GetLeafs(i);
+					if (!std::equal(front_leafs.begin(), front_leafs.end(), back_leafs.begin(), back_leafs.end()))
+					{
+						front_layer.Assign(i, back_leafs);
+						front_layer.dirty.Mark(x, y);
+					}
+				}
+			}
+
+			back_layer.dirty.Reset();
 		}
+
+		bool changed = !front.background_dirty.IsEmpty();
+		for (auto& i: front.layers)
+			changed = changed || !i.second.dirty.IsEmpty();
+		return changed;
 	}
 
 	State::State():
@@ -26,7 +26,9 @@
 #include "Atlas.hpp"
 #include "Color.hpp"
 #include "Tileset.hpp"
+#include "Utility.hpp"
 #include <memory>
+#include <map>
 #include <vector>
 #include <unordered_map>
 
@@ -40,25 +42,123 @@ namespace BearLibTerminal
 		char32_t code;
 		uint8_t flags;
 		uint8_t reserved;
+		mutable TileInfo* tile; // Resolved tile, valid while tile_generation matches g_tileset_generation.
+		mutable uint32_t tile_generation;
 		static const uint8_t CornerColored = 0x01;
+		bool operator==(const Leaf& other) const;
+		bool operator!=(const Leaf& other) const;
 	};
 
+	// A cell does not own its leafs; they live in the layer arena at [offset, offset+count).
+	// A cell stamped with a generation other than the layer's one is empty.
 	struct Cell
 	{
-		std::vector<Leaf> leafs;
+		Cell();
+		uint32_t offset;
+		uint16_t count;
+		uint16_t capacity;
+		uint32_t generation;
+	};
+
+	template<typename T> struct Range
+	{
+		Range(T* first, T* last): first(first), last(last) { }
+		template<typename U> Range(const Range<U>& other): first(other.first), last(other.last) { }
+		T* begin() const { return first; }
+		T* end() const { return last; }
+		size_t size() const { return last - first; }
+		bool empty() const { return first == last; }
+		T& operator[](size_t index) const { return first[index]; }
+		T* first;
+		T* last;
+	};
+
+	// Per-row spans of modified cells.
+	struct DirtyRows
+	{
+		struct Span
+		{
+			Span();
+			bool IsEmpty() const;
+			int left, right; // Columns [left, right).
+		};
+
+		DirtyRows();
+		DirtyRows(Size size);
+		void Mark(int x, int y);
+		void Mark(Rectangle area);
+		void MarkAll();
+		void Reset();
+		bool IsEmpty() const;
+		Rectangle GetBounds() const;
+
+		std::vector<Span> rows;
+		int width;
+		bool empty;
 	};
 
 	struct Layer
 	{
 		Layer(Size size);
+		Range<Leaf> GetLeafs(int index);
+		Range<const Leaf> GetLeafs(int index) const;
+		Leaf& Append(int index);
+		void Erase(int index);
+		void Assign(int index, Range<const Leaf> leafs);
+		void Clear();
+		void Compact();
+		bool IsEmpty() const;
+
+		// Calls func(x, y, index) for every cell holding any leafs, in row-major order.
+		template<typename F> void ForEachOccupied(F func) const
+		{
+			ForEachOccupied(0, size.height, func);
+		}
+
+		// Same, limited to rows [top, bottom).
+		template<typename F> void ForEachOccupied(int top, int bottom, F func) const
+		{
+			if (empty)
+				return;
+
+			for (int y = top; y < bottom; y++)
+			{
+				const uint64_t* row = occupancy.data() + y*row_words;
+				for (int w = 0; w < row_words; w++)
+				{
+					for (uint64_t bits = row[w]; bits != 0; bits &= bits - 1)
+					{
+						int x = w*64 + count_trailing_zeros(bits);
+						func(x, y, y*size.width + x);
+					}
+				}
+			}
+		}
+
+		Size size;
 		std::vector<Cell> cells;
+		std::vector<Leaf> arena;
+		size_t garbage; // Number of abandoned arena slots.
+		uint32_t generation;
+		bool empty; // Nothing was put since the last clear.
+		int row_words;
+		std::vector<uint64_t> occupancy; // One bit per non-empty cell, rows padded to whole words.
 		Rectangle crop;
+		DirtyRows dirty;
+
+	private:
+		Cell& Touch(int index);
+		void SetOccupied(int index, bool occupied);
+		Leaf* Reserve(Cell& cell, size_t count);
 	};
 
 	struct Scene
 	{
-		std::vector<Layer> layers;
+		Layer* FindLayer(int index);
+		Size size;
+		std::map<int, Layer> layers; // Allocated on first use only.
 		std::vector<Color> background;
+		DirtyRows background_dirty;
 	};
 
 	struct Stage
@@ -67,6 +167,8 @@ namespace BearLibTerminal
 		Scene frontbuffer;
 		Scene backbuffer;
 		void Resize(Size size);
+		bool Present(); // Returns whether the frontbuffer has changed.
+		Layer& AcquireLayer(int index);
 	};
 
 	struct State
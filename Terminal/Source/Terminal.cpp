@@ -30,6 +30,7 @@
 #include "Geometry.hpp"
 #include "Log.hpp"
 #include "Palette.hpp"
+#include "Platform.hpp"
 #include "BearLibTerminal.h"
 #include <cmath>
 #include <future>
@@ -48,7 +49,7 @@
 #if defined(DEBUG_TIMING)
 namespace BearLibTerminal
 {
-	average<float> time_scene_full, time_scene, time_copy, time_invoke, time_draw, time_swap;
+	average<float> time_scene_full, time_scene, time_copy, time_draw, time_batches, time_unsorted_batches;
 	uint64_t time_last_report_time = 0;
 }
 #endif
@@ -193,8 +194,12 @@ namespace BearLibTerminal
 
 	Terminal::Terminal():
 		m_state{kHidden},
+		m_headless{nullptr},
 		m_show_grid{false},
 		m_viewport_modified{false},
+		m_frame_outdated{true},
+		m_atlas_trimmed{0},
+		m_refresh_count{0},
 		m_scale_step(kScaleDefault),
 		m_alt_pressed(false)
 	{
@@ -218,8 +223,19 @@ namespace BearLibTerminal
 		m_options.log_level = Log::Instance().level;
 		m_options.log_mode = Log::Instance().mode;
 
+		// Window backend cannot be switched later, so it is taken from the configuration file
+		// or environment before anything else is applied.
+		if (!Config::Instance().TryGet(L"ini.bearlibterminal.window.backend", m_options.window_backend))
+			m_options.window_backend = GetEnvironmentVariable(L"BEARLIB_WINDOW_BACKEND", m_options.window_backend);
+		if (!Window::IsKnownBackend(m_options.window_backend))
+		{
+			LOG(Error, "Unknown window backend '" << m_options.window_backend << "', using native one");
+			m_options.window_backend = L"native";
+		}
+
 		// Try to create window
-		m_window = Window::Create(std::bind(&Terminal::OnWindowEvent, this, std::placeholders::_1));
+		m_window = Window::Create(m_options.window_backend, std::bind(&Terminal::OnWindowEvent, this, std::placeholders::_1));
+		m_headless = dynamic_cast<HeadlessWindow*>(m_window.get());
 
 		// Default parameters
 		SetOptionsInternal(L"window: size=80x25, icon=default; font: default; terminal.encoding=utf8; input.filter={keyboard}");
@@ -250,8 +266,12 @@ namespace BearLibTerminal
 
 	Terminal::~Terminal()
 	{
-		g_codespace.clear();
+		// Context must be back in this thread before any texture is released.
+		m_render_thread.reset();
+
+		g_codespace.Clear();
 		g_tilesets.clear();
+		g_tileset_generation += 1;
 		g_atlas.Clear();
 
 		// Window will be disposed of automatically.
@@ -282,15 +302,55 @@ namespace BearLibTerminal
 		}
 
 		LOG(Info, "Trying to set \"" << value << "\"");
+
+		// Options may reload tilesets and touch OpenGL state, so the render thread
+		// is stopped for the duration and its context returns to this thread.
+		m_render_thread.reset();
+
+		int result = 1;
 		try
 		{
 			SetOptionsInternal(value);
-			return 1;
 		}
 		catch (std::exception& e)
 		{
 			LOG(Error, "Failed to set some options: " << e.what());
-			return 0;
+			result = 0;
+		}
+
+		// Tiles or their appearance may have changed without any cell changing.
+		m_frame_outdated = true;
+
+		UpdateRenderThread();
+		return result;
+	}
+
+	void Terminal::UpdateRenderThread()
+	{
+		if (!m_options.output_asynchronous || m_headless)
+		{
+			m_render_thread.reset();
+			return;
+		}
+
+		if (m_render_thread)
+			return;
+
+		m_render_thread = RenderThread::Create(*m_window, [this](const RenderThread::Frame& frame)
+		{
+			Redraw(frame.scene, frame.viewport, frame.flags);
+			m_window->SwapBuffers();
+		});
+
+		if (!m_render_thread)
+		{
+			LOG(Warning, "Asynchronous rendering is not available, falling back to synchronous one");
+			m_options.output_asynchronous = false;
+		}
+		else
+		{
+			// The new context owner has not seen any viewport setup yet.
+			m_viewport_modified = true;
 		}
 	}
 
@@ -380,9 +440,10 @@ namespace BearLibTerminal
 
 	TileInfo* GetTileInfo(char32_t code)
 	{
-		auto i = g_codespace.find(code);
-		if (i != g_codespace.end())
-			return i->second.get();
+		if (auto tile = g_codespace.Find(code))
+			return tile;
+
+		std::lock_guard<std::recursive_mutex> guard(g_atlas_lock);
 
 		char32_t font_low = (code & Tileset::kFontOffsetMask);
 		char32_t font_high = font_low + Tileset::kCharOffsetMask;
@@ -397,8 +458,9 @@ namespace BearLibTerminal
 			if (j->second->Provides(code))
 			{
 				auto tile = j->second->Get(code);
-				g_codespace[code] = tile;
+				g_codespace.Add(code, tile);
 				g_atlas.Add(tile);
+				UpdateTileQuad(*tile);
 				return tile.get();
 			}
 		}
@@ -408,8 +470,9 @@ namespace BearLibTerminal
 			if (g_dynamic_tileset)
 			{
 				auto tile = g_dynamic_tileset->Get(code);
-				g_codespace[code] = tile;
+				g_codespace.Add(code, tile);
 				g_atlas.Add(tile);
+				UpdateTileQuad(*tile);
 				return tile.get();
 			}
 			else
@@ -419,7 +482,11 @@ namespace BearLibTerminal
 		}
 		else
 		{
-			return GetTileInfo(font_low + kUnicodeReplacementCharacter);
+			// Remember the substitution so tilesets are not asked about this code again.
+			auto tile = GetTileInfo(font_low + kUnicodeReplacementCharacter);
+			if (tile)
+				g_codespace.AddAlias(code, tile);
+			return tile;
 		}
 	}
 
@@ -430,6 +497,7 @@ namespace BearLibTerminal
 		std::unordered_map<char32_t, std::shared_ptr<Tileset>> new_tilesets;
 		std::unordered_map<std::wstring, Color> palette_update;
 		std::map<std::wstring, int> preallocated_fonts;
+		bool defragment_atlas = false;
 
 		// Validate options
 		for (auto& group: groups)
@@ -476,6 +544,13 @@ namespace BearLibTerminal
 					palette_update[kv.first] = Palette::Instance.Get(kv.second);
 				}
 			}
+			else if (group.name == L"atlas")
+			{
+				// Not an option but a command: "atlas: defragment".
+				if (group.attributes[L"_"] != L"defragment")
+					throw std::runtime_error("Unknown atlas command '" + UTF8Encoding().Convert(group.attributes[L"_"]) + "'");
+				defragment_atlas = true;
+			}
 			else
 			{
 				char32_t offset = ParseTilesetOffset(group.name, preallocated_fonts);
@@ -493,7 +568,7 @@ namespace BearLibTerminal
 			}
 		}
 
-		if (updated.output_vsync != m_options.output_vsync)
+		if (updated.output_vsync != m_options.output_vsync || updated.output_asynchronous != m_options.output_asynchronous)
 		{
 			m_viewport_modified = true;
 		}
@@ -504,6 +579,19 @@ namespace BearLibTerminal
 			g_atlas.ApplyTextureFilter();
 		}
 
+		if (updated.output_atlas_budget != m_options.output_atlas_budget)
+		{
+			g_atlas.SetBudget((size_t)updated.output_atlas_budget << 20);
+			m_atlas_trimmed = 0;
+		}
+
+		if (updated.output_renderer != m_options.output_renderer || updated.output_render_threads != m_options.output_render_threads || !m_renderer)
+		{
+			m_renderer = Renderer::Create(updated.output_renderer, updated.output_render_threads);
+			if (m_headless)
+				m_offscreen_renderer = Renderer::CreateOffscreen(updated.output_render_threads);
+		}
+
 		// All options and parameters must be validated, may try to apply them
 		for (auto& kv: preallocated_fonts)
 		{
@@ -515,8 +603,8 @@ namespace BearLibTerminal
 			if (kv.second)
 				AddTileset(kv.second);
 		}
-		g_atlas.Defragment();
 		g_atlas.CleanUp();
+		g_atlas.Defragment(defragment_atlas);
 
 		// Primary sanity check: if there is no base font, lots of things are gonna fail
 		if (!g_tilesets.count(0))
@@ -592,6 +680,8 @@ namespace BearLibTerminal
 				m_world.state.cellsize.height / 2
 			);
 
+			UpdateTileQuads(m_world.state.half_cellsize);
+
 			// Update state
 			m_vars[TK_CELL_WIDTH] = m_world.state.cellsize.width; // TODO: move vars to world.state
 			m_vars[TK_CELL_HEIGHT] = m_world.state.cellsize.height;
@@ -684,6 +774,7 @@ namespace BearLibTerminal
 		C.Set(L"window.resizeable", bool_to_wstring(m_options.window_resizeable));
 		C.Set(L"window.minimum-size", size_to_wstring(m_options.window_minimum_size));
 		C.Set(L"window.fullscreen", bool_to_wstring(m_options.window_fullscreen));
+		C.Set(L"window.backend", m_options.window_backend);
 		// input
 		C.Set(L"input.precise-mouse", bool_to_wstring(m_options.input_precise_mouse));
 		//C.Set(L"input.filter", m_options.input_filter_str); // FIXME
@@ -693,6 +784,10 @@ namespace BearLibTerminal
 		C.Set(L"input.alt-functions", bool_to_wstring(m_options.input_alt_functions));
 		// output
 		C.Set(L"output.vsync", bool_to_wstring(m_options.output_vsync));
+		C.Set(L"output.renderer", m_options.output_renderer);
+		C.Set(L"output.render-threads", to_string<wchar_t>(m_options.output_render_threads));
+		C.Set(L"output.asynchronous", bool_to_wstring(m_options.output_asynchronous));
+		C.Set(L"output.atlas-budget", to_string<wchar_t>(m_options.output_atlas_budget));
 		// log
 		C.Set(L"input.file", m_options.log_filename);
 		C.Set(L"input.level", to_string<wchar_t>(m_options.log_level));
@@ -801,6 +896,11 @@ namespace BearLibTerminal
 				throw std::runtime_error("window.fullscreen value cannot be parsed");
 			}
 		}
+
+		if (group.attributes.count(L"backend") && group.attributes[L"backend"] != options.window_backend)
+		{
+			throw std::runtime_error("window.backend can only be set in the configuration file or BEARLIB_WINDOW_BACKEND");
+		}
 	}
 
 	void Terminal::ValidateInputOptions(OptionGroup& group, Options& options)
@@ -947,7 +1047,7 @@ namespace BearLibTerminal
 
 	void Terminal::ValidateOutputOptions(OptionGroup& group, Options& options)
 	{
-		// Possible options: postformatting, vsync, tab-width
+		// Possible options: postformatting, vsync, tab-width, texture-filter, renderer, render-threads, asynchronous, atlas-budget
 
 		// TODO: deprecated
 		if (group.attributes.count(L"postformatting") && !try_parse(group.attributes[L"postformatting"], options.output_postformatting))
@@ -977,6 +1077,33 @@ namespace BearLibTerminal
 			else
 				throw std::runtime_error("output.texture-filter cannot be parsed");
 		}
+
+		if (group.attributes.count(L"renderer"))
+		{
+			if (!Renderer::IsKnown(group.attributes[L"renderer"]))
+				throw std::runtime_error("output.renderer cannot be parsed");
+
+			options.output_renderer = group.attributes[L"renderer"];
+		}
+
+		if (group.attributes.count(L"render-threads"))
+		{
+			// Zero means one thread per hardware thread.
+			if (!try_parse(group.attributes[L"render-threads"], options.output_render_threads) || options.output_render_threads < 0)
+				throw std::runtime_error("output.render-threads cannot be parsed");
+		}
+
+		if (group.attributes.count(L"asynchronous") && !try_parse(group.attributes[L"asynchronous"], options.output_asynchronous))
+		{
+			throw std::runtime_error("output.asynchronous cannot be parsed");
+		}
+
+		if (group.attributes.count(L"atlas-budget"))
+		{
+			// Zero means no limit.
+			if (!try_parse(group.attributes[L"atlas-budget"], options.output_atlas_budget) || options.output_atlas_budget < 0)
+				throw std::runtime_error("output.atlas-budget cannot be parsed");
+		}
 	}
 
 	void Terminal::ValidateLoggingOptions(OptionGroup& group, Options& options)
@@ -1002,6 +1129,8 @@ namespace BearLibTerminal
 #if defined(DEBUG_TIMING)
 	void Terminal::Refresh()
 	{
+		CHECK_THREAD("refresh", );
+
 		static uint64_t time_scene_prev = gettime();
 		uint64_t time_scene_now = gettime();
 		uint64_t scene_full = time_scene_now - time_scene_prev;
@@ -1011,51 +1140,66 @@ namespace BearLibTerminal
 		{
 			m_window->Show();
 			m_state = kVisible;
+
+			if (m_options.window_fullscreen)
+			{
+				m_window->SetFullscreen(true);
+				m_viewport_modified = true;
+			}
 		}
 
-		if (m_state != kVisible) return;
+		uint64_t time_copy_start = gettime();
+		bool modified = m_world.stage.Present();
+		uint64_t time_copy_end = gettime();
+		m_window->PumpEvents();
+
+		// Only trimmed again once the atlas has grown past what the previous eviction left.
+		size_t budget = g_atlas.GetBudget();
+		if (budget > 0 && g_atlas.GetMemoryUsage() > std::max(budget, m_atlas_trimmed))
+			TrimAtlas();
+
+		// Tiles removed since the last refresh may have left the atlas sparse.
+		if (g_atlas.IsFragmented())
+			DefragmentAtlas();
 
-		uint64_t time_copy_start;
-		// Synchronously copy backbuffer to frontbuffer
+		// An identical frame is neither drawn nor swapped again.
+		uint64_t time_draw_start = gettime();
+		if (modified || m_frame_outdated || m_viewport_modified)
 		{
-			std::lock_guard<std::mutex> guard(m_lock);
-			m_world.stage.frontbuffer = m_world.stage.backbuffer;
+			Render();
+			m_vars[TK_FRAMES_RENDERED] += 1;
 		}
-
-		uint64_t time_invoke_start = gettime(), time_draw_start, time_swap_start, time_swap_end;
-		m_window->Invoke([&]()
+		else
 		{
-			time_draw_start = gettime();
-			OnWindowRedraw();
-			time_swap_start = gettime();
-			m_window->SwapBuffers();
-			time_swap_end = gettime();
-		});
-		uint64_t time_invoke_end = gettime();
-
-		int64_t copy = time_invoke_start - time_copy_start;
-		int64_t draw = time_swap_start - time_draw_start;
-		int64_t swap = time_swap_end - time_swap_start;
-		int64_t invoke = time_invoke_end - time_invoke_start - (draw + swap);
-
-		copy = copy > 0? copy: 0;
-		draw = draw > 0? draw: 0;
-		swap = swap > 0? swap: 0;
-		invoke = invoke > 0? invoke: 0;
-		int64_t scene = ((int64_t)scene_full - (int64_t)(copy + draw + swap + invoke));
+			m_vars[TK_FRAMES_SKIPPED] += 1;
+		}
+		m_refresh_count += 1;
+		uint64_t time_draw_end = gettime();
+
+		// With the render thread, draw is the time to hand the frame over.
+		int64_t copy = time_copy_end - time_copy_start;
+		int64_t draw = time_draw_end - time_draw_start;
+		int64_t scene = (int64_t)scene_full - (int64_t)(time_draw_end - time_copy_start);
 		scene = scene > 0? scene: 0;
 
 		time_scene_full.add(scene_full);
 		time_scene.add(scene);
 		time_copy.add(copy);
-		time_invoke.add(invoke);
 		time_draw.add(draw);
-		time_swap.add(swap);
+
+		// Renderer statistics are only safe to read while it draws on this thread.
+		if (!m_render_thread)
+		{
+			RenderStatistics statistics = m_renderer->GetStatistics();
+			time_batches.add(statistics.batches);
+			time_unsorted_batches.add(statistics.unsorted_batches);
+		}
 
 		uint64_t now = gettime();
 		if (now > time_last_report_time + 1000000)
 		{
-			LOG(Trace, "Timing report: full scene " << time_scene_full.get() << ", bare scene " << time_scene.get() << ", copy " << time_copy.get() << ", invoke " << time_invoke.get() << ", draw " << time_draw.get() << ", swap " << time_swap.get());
+			LOG(Trace, "Timing report: full scene " << time_scene_full.get() << ", bare scene " << time_scene.get() << ", copy " << time_copy.get() << ", draw " << time_draw.get() <<
+				", texture batches " << time_batches.get() << " (" << time_unsorted_batches.get() << " in leaf order)");
 			time_last_report_time = now;
 		}
 	}
@@ -1076,9 +1220,29 @@ namespace BearLibTerminal
 			}
 		}
 
-		m_world.stage.frontbuffer = m_world.stage.backbuffer;
+		bool modified = m_world.stage.Present();
 		m_window->PumpEvents();
-		Render();
+
+		// Only trimmed again once the atlas has grown past what the previous eviction left.
+		size_t budget = g_atlas.GetBudget();
+		if (budget > 0 && g_atlas.GetMemoryUsage() > std::max(budget, m_atlas_trimmed))
+			TrimAtlas();
+
+		// Tiles removed since the last refresh may have left the atlas sparse.
+		if (g_atlas.IsFragmented())
+			DefragmentAtlas();
+
+		// An identical frame is neither drawn nor swapped again.
+		if (modified || m_frame_outdated || m_viewport_modified)
+		{
+			Render();
+			m_vars[TK_FRAMES_RENDERED] += 1;
+		}
+		else
+		{
+			m_vars[TK_FRAMES_SKIPPED] += 1;
+		}
+		m_refresh_count += 1;
 	}
 #endif
 
@@ -1091,21 +1255,21 @@ namespace BearLibTerminal
 		}
 		else
 		{
-			for (auto& layer: m_world.stage.backbuffer.layers)
+			for (auto& i: m_world.stage.backbuffer.layers)
 			{
-				for (auto& cell: layer.cells)
+				Layer& layer = i.second;
+				if (!layer.IsEmpty())
 				{
-					cell.leafs.clear();
+					layer.Clear();
+					layer.dirty.MarkAll();
 				}
-
 				layer.crop = Rectangle();
 			}
 		}
 
-		for (auto& color: m_world.stage.backbuffer.background)
-		{
-			color = m_world.state.bkcolor;
-		}
+		auto& background = m_world.stage.backbuffer.background;
+		std::fill(background.begin(), background.end(), m_world.state.bkcolor);
+		m_world.stage.backbuffer.background_dirty.MarkAll();
 	}
 
 	void Terminal::Clear(int x, int y, int w, int h)
@@ -1116,13 +1280,22 @@ namespace BearLibTerminal
 		if (x+w >= stage_size.width) w = stage_size.width-x;
 		if (y+h >= stage_size.height) h = stage_size.height-y;
 
-		Layer& layer = m_world.stage.backbuffer.layers[m_world.state.layer];
+		// Layers that hold nothing have nothing to erase.
+		Layer* layer = m_world.stage.backbuffer.FindLayer(m_world.state.layer);
+		if (layer && layer->IsEmpty())
+			layer = nullptr;
+
+		if (layer)
+			layer->dirty.Mark(Rectangle(x, y, w, h));
+		if (m_world.state.layer == 0)
+			m_world.stage.backbuffer.background_dirty.Mark(Rectangle(x, y, w, h));
+
 		for (int i=x; i<x+w; i++)
 		{
 			for (int j=y; j<y+h; j++)
 			{
 				int k = stage_size.width*j+i;
-				layer.cells[k].leafs.clear();
+				if (layer) layer->Erase(k);
 				if (m_world.state.layer == 0)
 				{
 					m_world.stage.backbuffer.background[k] = m_world.state.bkcolor;
@@ -1133,7 +1306,7 @@ namespace BearLibTerminal
 
 	void Terminal::SetCrop(int x, int y, int w, int h)
 	{
-		m_world.stage.backbuffer.layers[m_world.state.layer].crop =
+		m_world.stage.AcquireLayer(m_world.state.layer).crop =
 			Rectangle(m_world.stage.size).Intersection(Rectangle(x, y, w, h));
 	}
 
@@ -1144,11 +1317,6 @@ namespace BearLibTerminal
 		if (layer_index > 255) layer_index = 255;
 		m_world.state.layer = layer_index;
 		m_vars[TK_LAYER] = layer_index;
-
-		while (m_world.stage.backbuffer.layers.size() <= m_world.state.layer)
-		{
-			m_world.stage.backbuffer.layers.emplace_back(m_world.stage.size);
-		}
 	}
 
 	void Terminal::SetForeColor(Color color)
@@ -1195,29 +1363,27 @@ namespace BearLibTerminal
 		if (x < 0 || y < 0 || x >= m_world.stage.size.width || y >= m_world.stage.size.height) return;
 
 		// Prepare tile if necessary.
-		TileInfo* tile_info = nullptr;
-		auto it = g_codespace.find(code);
-		if (it != g_codespace.end())
-			tile_info = it->second.get();
-		else
-			tile_info = GetTileInfo(code);
+		TileInfo* tile_info = GetTileInfo(code);
+		if (tile_info)
+			tile_info->last_used = m_refresh_count;
 
-		// NOTE: layer must be already allocated by SetLayer
 		int index = y*m_world.stage.size.width+x;
-		Cell& cell = m_world.stage.backbuffer.layers[m_world.state.layer].cells[index];
+		Layer& layer = m_world.stage.AcquireLayer(m_world.state.layer);
+		layer.dirty.Mark(x, y);
 
 		if (code != 0)
 		{
 			if (m_world.state.composition == TK_OFF)
 			{
-				cell.leafs.clear();
+				layer.Erase(index);
 			}
 
-			cell.leafs.emplace_back();
-			Leaf& leaf = cell.leafs.back();
+			Leaf& leaf = layer.Append(index);
 
 			// Character
 			leaf.code = code;
+			leaf.tile = tile_info;
+			leaf.tile_generation = g_tileset_generation;
 
 			// Offset
 			leaf.dx = dx;
@@ -1237,6 +1403,7 @@ namespace BearLibTerminal
 			// Background color
 			if (m_world.state.layer == 0 && back)
 			{
+				m_world.stage.backbuffer.background_dirty.Mark(Rectangle(x, y, tile_info->spacing.width, tile_info->spacing.height));
 				for (int by = y; by < std::min(y+tile_info->spacing.height, m_world.stage.size.height); by++)
 				{
 					for (int bx = x; bx < std::min(x+tile_info->spacing.width, m_world.stage.size.width); bx++)
@@ -1249,10 +1416,11 @@ namespace BearLibTerminal
 		else
 		{
 			// Character code '0' means 'erase cell'
-			cell.leafs.clear();
+			layer.Erase(index);
 			if (m_world.state.layer == 0)
 			{
 				m_world.stage.backbuffer.background[index] = Color(); // Transparent color, no background
+				m_world.stage.backbuffer.background_dirty.Mark(x, y);
 			}
 		}
 	}
@@ -1277,10 +1445,13 @@ namespace BearLibTerminal
 		if (x < 0 || y < 0 || x >= m_world.stage.size.width || y >= m_world.stage.size.height) return 0;
 
 		int cell_index = y * m_world.stage.size.width + x;
-		auto& cell = m_world.stage.backbuffer.layers[m_world.state.layer].cells[cell_index];
+		Layer* layer = m_world.stage.backbuffer.FindLayer(m_world.state.layer);
+		if (!layer) return 0;
+
+		auto leafs = layer->GetLeafs(cell_index);
 		wchar_t code = 0;
-		if (index >= 0 && index < (int)cell.leafs.size())
-			code = (int)(cell.leafs[index].code & Tileset::kCharOffsetMask);
+		if (index >= 0 && index < (int)leafs.size())
+			code = (int)(leafs[index].code & Tileset::kCharOffsetMask);
 
 		// Must take into account possible terminal.encoding codepage.
 		int translated = m_encoding->Convert(code);
@@ -1292,8 +1463,11 @@ namespace BearLibTerminal
 		if (x < 0 || y < 0 || x >= m_world.stage.size.width || y >= m_world.stage.size.height) return Color();
 
 		int cell_index = y * m_world.stage.size.width + x;
-		auto& cell = m_world.stage.backbuffer.layers[m_world.state.layer].cells[cell_index];
-		return (index >= 0 && index < (int)cell.leafs.size())? cell.leafs[index].color[0]: Color();
+		Layer* layer = m_world.stage.backbuffer.FindLayer(m_world.state.layer);
+		if (!layer) return Color();
+
+		auto leafs = layer->GetLeafs(cell_index);
+		return (index >= 0 && index < (int)leafs.size())? leafs[index].color[0]: Color();
 	}
 
 	Color Terminal::PickBackColor(int x, int y)
@@ -1772,7 +1946,7 @@ namespace BearLibTerminal
 	{
 		CHECK_THREAD("read_str", TK_INPUT_CANCELLED);
 
-		std::vector<Cell> original;
+		std::vector<std::vector<Leaf>> original;
 		int composition_mode = m_world.state.composition;
 		m_world.state.composition = TK_ON;
 
@@ -1791,8 +1965,9 @@ namespace BearLibTerminal
 		max = std::min(max, m_world.stage.size.width-x);
 		for (int i=0; i<max; i++)
 		{
-			Layer& layer = m_world.stage.backbuffer.layers[m_world.state.layer];
-			original.push_back(layer.cells[y*m_world.stage.size.width+x+i]);
+			Layer& layer = m_world.stage.AcquireLayer(m_world.state.layer);
+			auto leafs = layer.GetLeafs(y*m_world.stage.size.width+x+i);
+			original.emplace_back(leafs.begin(), leafs.end());
 		}
 
 		// Garbage string protection
@@ -1810,8 +1985,9 @@ namespace BearLibTerminal
 		{
 			for (int i = 0; i < max; i++)
 			{
-				Layer& layer = m_world.stage.backbuffer.layers[m_world.state.layer];
-				layer.cells[y*m_world.stage.size.width+x+i] = original[i];
+				Layer& layer = m_world.stage.AcquireLayer(m_world.state.layer);
+				layer.Assign(y*m_world.stage.size.width+x+i, Range<const Leaf>(original[i].data(), original[i].data() + original[i].size()));
+				layer.dirty.Mark(x+i, y);
 			}
 		};
 
@@ -1941,17 +2117,36 @@ namespace BearLibTerminal
 			m_stage_area_factor = stage_size/m_stage_area.Size().As<float>();
 		}
 
+		m_window_size = viewport_size;
+
+		m_viewport_scissors = Rectangle
+		(
+			m_stage_area.left,
+			viewport_size.height - m_stage_area.height - m_stage_area.top,
+			m_stage_area.width,
+			m_stage_area.height
+		);
+
+		m_viewport_scissors_enabled = viewport_size != stage_size;
+	}
+
+	void Terminal::SetupViewport(const Viewport& viewport, bool vsync)
+	{
+		const Size& window_size = viewport.window_size;
+		const Rectangle& stage_area = viewport.stage_area;
+		const SizeF& factor = viewport.stage_area_factor;
+
 		glDisable(GL_DEPTH_TEST);
 		glClearColor(0, 0, 0, 1);
-		glViewport(0, 0, viewport_size.width, viewport_size.height);
+		glViewport(0, 0, window_size.width, window_size.height);
 		glMatrixMode(GL_PROJECTION);
 		glLoadIdentity();
 		glOrtho
 		(
-			-m_stage_area.left * m_stage_area_factor.width,
-			(viewport_size.width - m_stage_area.left) * m_stage_area_factor.width,
-			(viewport_size.height - m_stage_area.top) * m_stage_area_factor.height,
-			-m_stage_area.top * m_stage_area_factor.height,
+			-stage_area.left * factor.width,
+			(window_size.width - stage_area.left) * factor.width,
+			(window_size.height - stage_area.top) * factor.height,
+			-stage_area.top * factor.height,
 			-1,
 			+1
 		);
@@ -1961,295 +2156,83 @@ namespace BearLibTerminal
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		m_viewport_scissors = Rectangle
-		(
-			m_stage_area.left,
-			viewport_size.height - m_stage_area.height - m_stage_area.top,
-			m_stage_area.width,
-			m_stage_area.height
-		);
-
-		m_viewport_scissors_enabled = viewport_size != stage_size;
-
 		// ?..
-		m_window->SetVSync(m_options.output_vsync);
+		m_window->SetVSync(vsync);
 	}
 
-	void DrawTile(const Leaf& leaf, const TileInfo& tile, int x, int y, int w2, int h2)
+	void Terminal::Redraw(const Scene& scene, const Viewport& viewport, int flags)
 	{
-		// TODO: Think up of some optimization?
-		// There are a lot of calculations done.
-
-		int left, top;
-
-		w2 *= tile.spacing.width;
-		h2 *= tile.spacing.height;
-
-		switch (tile.alignment)
-		{
-		case TileAlignment::Center:
-		case TileAlignment::DeadCenter:
-			left = x + tile.offset.x + w2 + leaf.dx;
-			top = y + tile.offset.y + h2 + leaf.dy;
-			break;
-		case TileAlignment::TopRight:
-			left = x + tile.offset.x + 2*w2 - tile.useful_space.width + leaf.dx;
-			top = y + tile.offset.y + leaf.dy;
-			break;
-		case TileAlignment::BottomLeft:
-			left = x + tile.offset.x + leaf.dx;
-			top = y + tile.offset.y + 2*h2 - tile.useful_space.height + leaf.dy;
-			break;
-		case TileAlignment::BottomRight:
-			left = x + tile.offset.x + 2*w2 - tile.useful_space.width + leaf.dx;
-			top = y + tile.offset.y + 2*h2 - tile.useful_space.height + leaf.dy;
-			break;
-		case TileAlignment::TopLeft:
-		default:
-			// Same as TopLeft
-			left = x + tile.offset.x + leaf.dx;
-			top = y + tile.offset.y + leaf.dy;
-			break;
-		}
-
-		int right = left + tile.useful_space.width;
-		int bottom = top + tile.useful_space.height;
-
-		if (leaf.flags & Leaf::CornerColored)
-		{
-			/*
-			// Single-quad version (incorrect interpolation)
-			// Top-left
-			glColor4ub(leaf.color[0].r, leaf.color[0].g, leaf.color[0].b, leaf.color[0].a);
-			glTexCoord2f(texture_coords.tu1, texture_coords.tv1);
-			glVertex2i(left, top);
-
-			// Bottom-left
-			glColor4ub(leaf.color[1].r, leaf.color[1].g, leaf.color[1].b, leaf.color[1].a);
-			glTexCoord2f(texture_coords.tu1, texture_coords.tv2);
-			glVertex2i(left, bottom);
-
-			// Bottom-right
-			glColor4ub(leaf.color[2].r, leaf.color[2].g, leaf.color[2].b, leaf.color[2].a);
-			glTexCoord2f(texture_coords.tu2, texture_coords.tv2);
-			glVertex2i(right, bottom);
-
-			// Top-right
-			glColor4ub(leaf.color[3].r, leaf.color[3].g, leaf.color[3].b, leaf.color[3].a);
-			glTexCoord2f(texture_coords.tu2, texture_coords.tv1);
-			glVertex2i(right, top);
-			/*/
-
-			// 2-quad version
-			// Center color
-			int cr = (leaf.color[0].r + leaf.color[1].r + leaf.color[2].r + leaf.color[3].r)/4;
-			int cg = (leaf.color[0].g + leaf.color[1].g + leaf.color[2].g + leaf.color[3].g)/4;
-			int cb = (leaf.color[0].b + leaf.color[1].b + leaf.color[2].b + leaf.color[3].b)/4;
-			int ca = (leaf.color[0].a + leaf.color[1].a + leaf.color[2].a + leaf.color[3].a)/4;
-			// Center texture coords
-			float cu = (tile.texture_coords.tu1 + tile.texture_coords.tu2)/2.0f;
-			float cv = (tile.texture_coords.tv1 + tile.texture_coords.tv2)/2.0f;
-			// Center coordinate
-			float cx = (left + right)/2.0f;
-			float cy = (top + bottom)/2.0f;
-
-			// First quad
-			// Top-left
-			glColor4ub(leaf.color[0].r, leaf.color[0].g, leaf.color[0].b, leaf.color[0].a);
-			glTexCoord2f(tile.texture_coords.tu1, tile.texture_coords.tv1);
-			glVertex2i(left, top);
-			// Bottom-left
-			glColor4ub(leaf.color[1].r, leaf.color[1].g, leaf.color[1].b, leaf.color[1].a);
-			glTexCoord2f(tile.texture_coords.tu1, tile.texture_coords.tv2);
-			glVertex2i(left, bottom);
-			// Center
-			glColor4ub(cr, cg, cb, ca);
-			glTexCoord2f(cu, cv);
-			glVertex2i(cx, cy);
-			// Top-right
-			glColor4ub(leaf.color[3].r, leaf.color[3].g, leaf.color[3].b, leaf.color[3].a);
-			glTexCoord2f(tile.texture_coords.tu2, tile.texture_coords.tv1);
-			glVertex2i(right, top);
-
-			// Second squad
-			// Bottom-right
-			glColor4ub(leaf.color[2].r, leaf.color[2].g, leaf.color[2].b, leaf.color[2].a);
-			glTexCoord2f(tile.texture_coords.tu2, tile.texture_coords.tv2);
-			glVertex2i(right, bottom);
-			// Top-right
-			glColor4ub(leaf.color[3].r, leaf.color[3].g, leaf.color[3].b, leaf.color[3].a);
-			glTexCoord2f(tile.texture_coords.tu2, tile.texture_coords.tv1);
-			glVertex2i(right, top);
-			// Center
-			glColor4ub(cr, cg, cb, ca);
-			glTexCoord2f(cu, cv);
-			glVertex2i(cx, cy);
-			// Bottom-left
-			glColor4ub(leaf.color[1].r, leaf.color[1].g, leaf.color[1].b, leaf.color[1].a);
-			glTexCoord2f(tile.texture_coords.tu1, tile.texture_coords.tv2);
-			glVertex2i(left, bottom);
-			//*/
-		}
-		else
-		{
-			// Single-colored version
-			glColor4ub(leaf.color[0].r, leaf.color[0].g, leaf.color[0].b, leaf.color[0].a);
+		// Window contents may be lost (e. g. on expose) while the frame itself is the same.
+		if ((flags & RenderThread::Frame::Unchanged) && m_frame_cache.Present(viewport.window_size))
+			return;
 
-			// Top-left
-			glTexCoord2f(tile.texture_coords.tu1, tile.texture_coords.tv1);
-			glVertex2i(left, top);
+		if (flags & RenderThread::Frame::Reconfigure)
+			SetupViewport(viewport, flags & RenderThread::Frame::VSync);
 
-			// Bottom-left
-			glTexCoord2f(tile.texture_coords.tu1, tile.texture_coords.tv2);
-			glVertex2i(left, bottom);
+		// The cached previous frame only needs the changed cells drawn over it.
+		bool partial = (flags & RenderThread::Frame::Partial) && m_frame_cache.HasFrame(viewport.window_size);
+		bool cached = m_frame_cache.Begin(viewport.window_size);
 
-			// Bottom-right
-			glTexCoord2f(tile.texture_coords.tu2, tile.texture_coords.tv2);
-			glVertex2i(right, bottom);
+		std::lock_guard<std::recursive_mutex> guard(g_atlas_lock);
 
-			// Top-right
-			glTexCoord2f(tile.texture_coords.tu2, tile.texture_coords.tv1);
-			glVertex2i(right, top);
+		Viewport target = viewport;
+		if (cached)
+		{
+			// Old contents of a changed cell may spill over it as far as any tile drawn before.
+			Size overflow = GetTileOverflow(scene, viewport, partial);
+			m_tile_overflow = partial? Size(std::max(m_tile_overflow.width, overflow.width), std::max(m_tile_overflow.height, overflow.height)): overflow;
 		}
-	}
 
-	int Terminal::Redraw()
-	{
-		if (m_viewport_modified)
+		if (partial)
 		{
-			ConfigureViewport();
-			m_viewport_modified = false;
+			target.clip = GetDamagedArea(scene, viewport, m_tile_overflow);
+			if (target.clip.Area() == 0)
+			{
+				m_frame_cache.End();
+				return;
+			}
 		}
 
 		// Clear must be done between scissoring test switch
 		glDisable(GL_SCISSOR_TEST);
-		glClear(GL_COLOR_BUFFER_BIT);
-
-		if (m_viewport_scissors_enabled)
+		if (partial)
 		{
+			auto& clip = target.clip;
 			glEnable(GL_SCISSOR_TEST);
-			auto& scissors = m_viewport_scissors;
-			glScissor(scissors.left, scissors.top, scissors.width, scissors.height);
+			glScissor(clip.left, clip.top, clip.width, clip.height);
 		}
+		glClear(GL_COLOR_BUFFER_BIT);
 
-		// Backgrounds
-		Texture::Disable();
-		glBegin(GL_QUADS);
+		if (viewport.scissors_enabled || partial)
 		{
-			int i = 0, left = 0, top = 0;
-			int w = m_world.state.cellsize.width;
-			int h = m_world.state.cellsize.height;
-			for (int y=0; y<m_world.stage.size.height; y++)
-			{
-				for (int x=0; x<m_world.stage.size.width; x++)
-				{
-					Color& c = m_world.stage.frontbuffer.background[i];
-					if (c.a > 0)
-					{
-						glColor4ub(c.r, c.g, c.b, c.a);
-						glVertex2i(left+0, top+0);
-						glVertex2i(left+0, top+h);
-						glVertex2i(left+w, top+h);
-						glVertex2i(left+w, top+0);
-					}
-
-					i += 1;
-					left += w;
-				}
-
-				left = 0;
-				top += h;
-			}
+			Rectangle scissors = target.ClipScissors(viewport.scissors);
+			glEnable(GL_SCISSOR_TEST);
+			glScissor(scissors.left, scissors.top, scissors.width, scissors.height);
 		}
-		glEnd();
-
-		Texture::Enable();
-
-		int w2 = m_world.state.half_cellsize.width;
-		int h2 = m_world.state.half_cellsize.height;
-		bool layer_scissors_applied = false;
-
-		AtlasTexture* current_texture = nullptr;
-		auto replacement_tile = GetTileInfo(kUnicodeReplacementCharacter);
-
-		glBegin(GL_QUADS);
-		glColor4f(1, 1, 1, 1);
-		for (auto& layer: m_world.stage.frontbuffer.layers)
-		{
-			if (layer.crop.Area() > 0)
-			{
-				Rectangle scissors = layer.crop * m_world.state.cellsize / m_stage_area_factor;
-				scissors.top = m_viewport_scissors.height - (scissors.top+scissors.height);
-				scissors += m_viewport_scissors.Location();
-
-				glEnd();
-				glEnable(GL_SCISSOR_TEST);
-				glScissor(scissors.left, scissors.top, scissors.width, scissors.height);
-				glBegin(GL_QUADS);
-
-				layer_scissors_applied = true;
-			}
-
-			int i = 0, left = 0, top = 0;
-
-			for (int y=0; y<m_world.stage.size.height; y++)
-			{
-				for (int x=0; x<m_world.stage.size.width; x++)
-				{
-					for (auto& leaf: layer.cells[i].leafs)
-					{
-						auto i = g_codespace.find(leaf.code);
-						auto tile = (i == g_codespace.end()? replacement_tile: i->second.get());
-
-						if (tile->texture != current_texture)
-						{
-							glEnd();
-							tile->texture->Bind();
-							current_texture = tile->texture;
-							glBegin(GL_QUADS);
-						}
-
-						DrawTile(leaf, *tile, left, top, w2, h2);
-					}
 
-					i += 1;
-					left += m_world.state.cellsize.width;
-				}
-
-				left = 0;
-				top += m_world.state.cellsize.height;
-			}
-
-			if (layer_scissors_applied)
-			{
-				glEnd();
-				auto& scissors = m_viewport_scissors;
-				glScissor(scissors.left, scissors.top, scissors.width, scissors.height);
-				glBegin(GL_QUADS);
-				layer_scissors_applied = false;
-			}
-		}
-		glEnd();
+		m_renderer->Draw(scene, target);
 
-		if (m_show_grid)
+		if (flags & RenderThread::Frame::ShowGrid)
 		{
-			int width = m_world.stage.size.width * m_world.state.cellsize.width;
-			int height = m_world.stage.size.height * m_world.state.cellsize.height;
+			const Size& stage_size = viewport.stage_size;
+			const Size& cellsize = viewport.cellsize;
+			int width = stage_size.width * cellsize.width;
+			int height = stage_size.height * cellsize.height;
 			glColor4f(1, 1, 1, 0.5f);
 			glDisable(GL_TEXTURE_2D);
 			glBlendFunc(GL_ONE_MINUS_DST_COLOR, GL_ZERO);
 			glBegin(GL_LINES);
-			for (int i=0; i<=m_world.stage.size.width; i++)
+			for (int i=0; i<=stage_size.width; i++)
 			{
-				int x = i*m_world.state.cellsize.width;
-				//if (i == m_world.stage.size.width) x -= 1;
+				int x = i*cellsize.width;
+				//if (i == stage_size.width) x -= 1;
 				glVertex2i(x, 0);
 				glVertex2i(x, height);
 			}
-			for (int i=0; i<=m_world.stage.size.height; i++)
+			for (int i=0; i<=stage_size.height; i++)
 			{
-				int y = i*m_world.state.cellsize.height;
-				//if (i == m_world.stage.size.height) y -= 1;
+				int y = i*cellsize.height;
+				//if (i == stage_size.height) y -= 1;
 				glVertex2i(0, y);
 				glVertex2i(width, y);
 			}
@@ -2258,7 +2241,8 @@ namespace BearLibTerminal
 			glEnable(GL_TEXTURE_2D);
 		}
 
-		return 1;
+		if (cached)
+			m_frame_cache.End();
 	}
 
 	void Terminal::PushEvent(Event event)
@@ -2270,7 +2254,7 @@ namespace BearLibTerminal
 	{
 		if (event.code == TK_REDRAW)
 		{
-			Render();
+			Render(true);
 			return 0;
 		}
 		else if (event.code == TK_INVALIDATE)
@@ -2389,6 +2373,7 @@ namespace BearLibTerminal
 			{
 				// Alt+G: toggle grid
 				m_show_grid = !m_show_grid;
+				m_frame_outdated = true;
 				Render();
 				return 0;
 			}
@@ -2443,7 +2428,10 @@ namespace BearLibTerminal
 			{
 				m_options.output_texture_filter = g_texture_filter =
 					(g_texture_filter == GL_LINEAR)? GL_NEAREST: GL_LINEAR;
+				m_render_thread.reset();
 				g_atlas.ApplyTextureFilter();
+				UpdateRenderThread();
+				m_frame_outdated = true;
 				Render();
 				return 0;
 			}
@@ -2523,10 +2511,132 @@ namespace BearLibTerminal
 		m_vars[TK_EVENT] = event.code;
 	}
 
-	void Terminal::Render()
+	Viewport Terminal::GetViewport() const
+	{
+		Viewport viewport;
+		viewport.stage_size = m_world.stage.size;
+		viewport.cellsize = m_world.state.cellsize;
+		viewport.half_cellsize = m_world.state.half_cellsize;
+		viewport.window_size = m_window_size;
+		viewport.stage_area = m_stage_area;
+		viewport.scissors = m_viewport_scissors;
+		viewport.scissors_enabled = m_viewport_scissors_enabled;
+		viewport.stage_area_factor = m_stage_area_factor;
+		viewport.clip = Rectangle(m_window_size);
+		viewport.replacement_tile = GetTileInfo(kUnicodeReplacementCharacter);
+		return viewport;
+	}
+
+	void Terminal::RedrawOffscreen()
 	{
-		Redraw();
-		m_window->SwapBuffers();
+		Bitmap& surface = m_headless->GetSurface();
+		Size size = m_world.stage.size * m_world.state.cellsize;
+		if (surface.GetSize() != size)
+			surface = Bitmap(size, Color());
+
+		m_offscreen_renderer->Render(m_world.stage.frontbuffer, GetViewport(), surface);
+	}
+
+	void Terminal::DefragmentAtlas()
+	{
+		// Textures get released, so the context must be current in this thread.
+		m_render_thread.reset();
+		g_atlas.CleanUp();
+		g_atlas.Defragment();
+		UpdateRenderThread();
+	}
+
+	void Terminal::TrimAtlas()
+	{
+		// Tiles of the frame about to be drawn must stay whenever they were put.
+		uint32_t frame = m_refresh_count;
+		for (auto& slot: m_world.stage.frontbuffer.layers)
+		{
+			const Layer& layer = slot.second;
+			layer.ForEachOccupied([&](int, int, int index)
+			{
+				for (auto& leaf: layer.GetLeafs(index))
+				{
+					if (auto tile = g_codespace.Find(leaf.code))
+						tile->last_used = frame;
+				}
+			});
+		}
+		if (auto tile = GetTileInfo(kUnicodeReplacementCharacter))
+			tile->last_used = frame;
+
+		// Nothing is dropped while the tiles would fit into half of the budget anyway.
+		if (g_atlas.GetUsedMemory() > g_atlas.GetBudget() / 2)
+		{
+			// Textures get released, so the context must be current in this thread.
+			m_render_thread.reset();
+			if (EvictTiles(frame) > 0)
+			{
+				g_atlas.CleanUp();
+				g_atlas.Defragment();
+			}
+			UpdateRenderThread();
+		}
+
+		m_atlas_trimmed = g_atlas.GetMemoryUsage();
+	}
+
+	void Terminal::Render(bool expose)
+	{
+		int flags = 0;
+		if (!m_frame_outdated && !m_viewport_modified)
+			flags |= expose? RenderThread::Frame::Unchanged: RenderThread::Frame::Partial;
+		m_frame_outdated = false;
+
+		if (m_viewport_modified)
+		{
+			ConfigureViewport();
+			m_viewport_modified = false;
+			flags |= RenderThread::Frame::Reconfigure;
+		}
+		if (m_show_grid)
+			flags |= RenderThread::Frame::ShowGrid;
+		if (m_options.output_vsync)
+			flags |= RenderThread::Frame::VSync;
+
+		if (m_headless)
+		{
+			RedrawOffscreen();
+			m_window->SwapBuffers();
+		}
+		else if (m_render_thread)
+		{
+			// Returns as soon as the scene is copied; the render thread draws and swaps it.
+			m_render_thread->Submit(m_world.stage.frontbuffer, GetViewport(), flags);
+		}
+		else
+		{
+			Redraw(m_world.stage.frontbuffer, GetViewport(), flags);
+			m_window->SwapBuffers();
+		}
+	}
+
+	int Terminal::Inject(int code, int x, int y)
+	{
+		CHECK_THREAD("inject", 0);
+
+		if (!m_headless)
+		{
+			LOG(Error, "Events can only be injected with window.backend=headless");
+			return 0;
+		}
+
+		return m_headless->Inject(code, x, y)? 1: 0;
+	}
+
+	const Color* Terminal::GetFrame(Size& size)
+	{
+		if (!m_headless || m_state != kVisible)
+			return nullptr;
+
+		Bitmap& surface = m_headless->GetSurface();
+		size = surface.GetSize();
+		return size.Area()? surface.GetData(): nullptr;
 	}
 
 	Terminal::PutArrayTileLayout::Field::Field():
@@ -26,6 +26,11 @@
 #include "Color.hpp"
 #include "Stage.hpp"
 #include "Window.hpp"
+#include "Renderer.hpp"
+#include "HeadlessWindow.hpp"
+#include "SoftwareRenderer.hpp"
+#include "RenderThread.hpp"
+#include "FrameCache.hpp"
 #include "Options.hpp"
 #include "Encoding.hpp"
 #include "OptionGroup.hpp"
@@ -66,6 +71,8 @@ namespace BearLibTerminal
 		const Encoding8& GetEncoding() const;
 		std::wstring GetClipboard();
 		int PutArray(int x, int y, int w, int h, const uint8_t* data, int row_stride, int column_stride, const std::wstring& layout);
+		int Inject(int code, int x, int y);
+		const Color* GetFrame(Size& size);
 	private:
 		void SetOptionsInternal(const std::wstring& params);
 		void ValidateWindowOptions(OptionGroup& group, Options& options);
@@ -75,12 +82,18 @@ namespace BearLibTerminal
 		void ValidateLoggingOptions(OptionGroup& group, Options& options);
 		bool ParseInputFilter(const std::wstring& s, std::set<int>& out);
 		void ConfigureViewport();
+		Viewport GetViewport() const;
 		void PutInternal(int x, int y, int dx, int dy, char32_t code, Color* colors);
 		void PutInternal2(int x, int y, int dx, int dy, char32_t code, Color fore, Color back, Color* colors);
 		void ConsumeEvent(Event& event);
 		Event ReadEvent(int timeout);
-		void Render();
-		int Redraw();
+		void SetupViewport(const Viewport& viewport, bool vsync);
+		void UpdateRenderThread();
+		void Render(bool expose=false);
+		void TrimAtlas();
+		void DefragmentAtlas();
+		void Redraw(const Scene& scene, const Viewport& viewport, int flags);
+		void RedrawOffscreen();
 		int OnWindowEvent(Event event);
 		void PushEvent(Event event);
 		bool IsEventFiltered(int code);
@@ -89,6 +102,12 @@ namespace BearLibTerminal
 		enum state_t {kHidden, kVisible, kClosed} m_state;
 		std::thread::id m_main_thread_id;
 		std::unique_ptr<Window> m_window;
+		std::unique_ptr<Renderer> m_renderer;
+		HeadlessWindow* m_headless;
+		std::unique_ptr<SoftwareRenderer> m_offscreen_renderer;
+		std::unique_ptr<RenderThread> m_render_thread;
+		FrameCache m_frame_cache;
+		Size m_tile_overflow; // Of every tile in the cached frame, see GetTileOverflow.
 		std::deque<Event> m_input_queue;
 		std::array<int32_t, 256> m_vars;
 		std::unique_ptr<Encoding8> m_encoding;
@@ -98,8 +117,12 @@ namespace BearLibTerminal
 		std::map<std::wstring, std::unique_ptr<Encoding8>> m_codepage_cache;
 		bool m_show_grid;
 		bool m_viewport_modified;
+		bool m_frame_outdated; // Must be drawn again even if the scene is the same.
+		size_t m_atlas_trimmed; // Atlas memory left after the last eviction, see TrimAtlas.
+		uint32_t m_refresh_count; // Stamps tiles put since the last refresh, wraps around.
 		Rectangle m_viewport_scissors;
 		bool m_viewport_scissors_enabled;
+		Size m_window_size;
 		int m_scale_step;
 		Rectangle m_stage_area;
 		SizeF m_stage_area_factor;
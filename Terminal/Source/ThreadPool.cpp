@@ -0,0 +1,110 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ThreadPool.hpp"
+
+namespace BearLibTerminal
+{
+	ThreadPool::ThreadPool(size_t concurrency):
+		m_count(0),
+		m_next(0),
+		m_pending(0),
+		m_job(0),
+		m_stop(false)
+	{
+		for (size_t i = 1; i < concurrency; i++)
+			m_threads.emplace_back(&ThreadPool::Work, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+
+		for (auto& thread: m_threads)
+			thread.join();
+	}
+
+	size_t ThreadPool::GetConcurrency() const
+	{
+		return m_threads.size() + 1;
+	}
+
+	void ThreadPool::Run(size_t count, std::function<void(size_t)> func)
+	{
+		if (m_threads.empty() || count < 2)
+		{
+			for (size_t i = 0; i < count; i++)
+				func(i);
+			return;
+		}
+
+		std::unique_lock<std::mutex> guard(m_lock);
+		m_func = std::move(func);
+		m_count = count;
+		m_next = 0;
+		m_pending = count;
+		m_job += 1;
+		m_wake.notify_all();
+
+		while (Step(guard));
+		m_done.wait(guard, [&]{return m_pending == 0;});
+		m_func = nullptr;
+	}
+
+	bool ThreadPool::Step(std::unique_lock<std::mutex>& guard)
+	{
+		// Must be called with the lock held, which is released for the duration of the call.
+		if (m_next >= m_count)
+			return false;
+
+		size_t index = m_next++;
+		auto& func = m_func;
+		guard.unlock();
+		func(index);
+		guard.lock();
+
+		if (--m_pending == 0)
+			m_done.notify_all();
+
+		return true;
+	}
+
+	void ThreadPool::Work()
+	{
+		std::unique_lock<std::mutex> guard(m_lock);
+		uint64_t last_job = 0;
+
+		while (true)
+		{
+			m_wake.wait(guard, [&]{return m_stop || m_job != last_job;});
+			if (m_stop)
+				break;
+
+			last_job = m_job;
+			while (Step(guard));
+		}
+	}
+}
@@ -0,0 +1,64 @@
+/*
+* BearLibTerminal
+* Copyright (C) 2026 Cfyz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+* of the Software, and to permit persons to whom the Software is furnished to do
+* so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BEARLIBTERMINAL_THREADPOOL_HPP
+#define BEARLIBTERMINAL_THREADPOOL_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+namespace BearLibTerminal
+{
+	// Fixed set of worker threads for splitting a job into independent parts.
+	// The calling thread takes part in the job as well.
+	class ThreadPool
+	{
+	public:
+		ThreadPool(size_t concurrency);
+		~ThreadPool();
+		size_t GetConcurrency() const;
+
+		// Calls func(i) for every i in [0, count) and waits for all of them to finish.
+		void Run(size_t count, std::function<void(size_t)> func);
+
+	private:
+		void Work();
+		bool Step(std::unique_lock<std::mutex>& guard);
+
+		std::vector<std::thread> m_threads;
+		std::mutex m_lock;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		std::function<void(size_t)> m_func;
+		size_t m_count;
+		size_t m_next;
+		size_t m_pending;
+		uint64_t m_job;
+		bool m_stop;
+	};
+}
+
+#endif // BEARLIBTERMINAL_THREADPOOL_HPP
@@ -29,16 +29,21 @@
 #include "Geometry.hpp"
 #include "Log.hpp"
 #include <stdexcept>
+#include <algorithm>
 #include <set>
 
 namespace BearLibTerminal
 {
-	std::unordered_map<char32_t, std::shared_ptr<TileInfo>> g_codespace;
+	Codespace g_codespace;
 
 	std::map<char32_t, std::shared_ptr<Tileset>> g_tilesets;
 
 	std::shared_ptr<Tileset> g_dynamic_tileset;
 
+	uint32_t g_tileset_generation = 1;
+
+	static Size g_tile_half_cellsize;
+
 	std::string GuessResourceFormat(const std::vector<uint8_t>& data)
 	{
 		auto compare = [&data](const char* magic, size_t size) -> bool
@@ -91,6 +96,9 @@ namespace BearLibTerminal
 		return i->second;
 	}
 
+	void Tileset::Evict(char32_t)
+	{ }
+
 	std::shared_ptr<Tileset> Tileset::Create(OptionGroup& options, char32_t offset)
 	{
 		std::wstring resource = options.attributes[L"_"];
@@ -161,13 +169,15 @@ namespace BearLibTerminal
 	{
 		char32_t offset = tileset->GetOffset();
 		g_tilesets[offset] = tileset;
+		g_tileset_generation += 1;
+		g_codespace.ClearAliases();
 
 		for (auto i = g_codespace.begin(); i != g_codespace.end(); )
 		{
 			if (i->first >= offset && i->second->tileset->GetOffset() < offset && tileset->Provides(i->first))
 			{
-				i->second->texture->Remove(i->second, true);
-				i = g_codespace.erase(i);
+				g_atlas.Remove(i->second, true);
+				i = g_codespace.Erase(i);
 			}
 			else
 			{
@@ -178,12 +188,15 @@ namespace BearLibTerminal
 
 	void RemoveTileset(std::shared_ptr<Tileset> tileset)
 	{
+		g_tileset_generation += 1;
+		g_codespace.ClearAliases();
+
 		for (auto i = g_codespace.begin(); i != g_codespace.end(); )
 		{
 			if (i->second->tileset == tileset.get())
 			{
-				i->second->texture->Remove(i->second);
-				i = g_codespace.erase(i);
+				g_atlas.Remove(i->second);
+				i = g_codespace.Erase(i);
 			}
 			else
 			{
@@ -201,6 +214,48 @@ namespace BearLibTerminal
 			RemoveTileset(i->second);
 	}
 
+	size_t EvictTiles(uint32_t frame)
+	{
+		std::vector<Codespace::iterator> candidates;
+		for (auto i = g_codespace.begin(); i != g_codespace.end(); ++i)
+		{
+			if (i->second->texture != nullptr && i->second->last_used != frame)
+				candidates.push_back(i);
+		}
+
+		// Oldest first; stamps are compared by age so that frame counter wrap-around does not matter.
+		std::sort(candidates.begin(), candidates.end(), [frame](const Codespace::iterator& lhs, const Codespace::iterator& rhs)
+		{
+			return frame - lhs->second->last_used > frame - rhs->second->last_used;
+		});
+
+		size_t target = g_atlas.GetBudget() / 2;
+		size_t used = g_atlas.GetUsedMemory();
+		size_t count = 0;
+		for (auto i: candidates)
+		{
+			if (used <= target)
+				break;
+
+			used -= i->second->total_space.Area() * sizeof(Color);
+			g_atlas.Remove(i->second);
+			i->second->tileset->Evict(i->first);
+			g_codespace.Erase(i);
+			count += 1;
+		}
+
+		if (count > 0)
+		{
+			g_tileset_generation += 1;
+			g_codespace.ClearAliases();
+		}
+
+		LOG(Debug, "Evicted " << count << " of " << candidates.size() << " unused tiles, the rest take " <<
+			used << " bytes of " << g_atlas.GetBudget() << " budget");
+
+		return count;
+	}
+
 	void UpdateDynamicTileset(Size cell_size)
 	{
 		if (g_dynamic_tileset)
@@ -210,4 +265,47 @@ namespace BearLibTerminal
 
 		g_dynamic_tileset = std::make_shared<DynamicTileset>(0xFFFFFF, cell_size);
 	}
+
+	void UpdateTileQuads(Size half_cellsize)
+	{
+		g_tile_half_cellsize = half_cellsize;
+
+		for (auto& i: g_codespace)
+			UpdateTileQuad(*i.second);
+	}
+
+	void UpdateTileQuad(TileInfo& tile)
+	{
+		int w2 = g_tile_half_cellsize.width * tile.spacing.width;
+		int h2 = g_tile_half_cellsize.height * tile.spacing.height;
+		int left, top;
+
+		switch (tile.alignment)
+		{
+		case TileAlignment::Center:
+		case TileAlignment::DeadCenter:
+			left = tile.offset.x + w2;
+			top = tile.offset.y + h2;
+			break;
+		case TileAlignment::TopRight:
+			left = tile.offset.x + 2*w2 - tile.useful_space.width;
+			top = tile.offset.y;
+			break;
+		case TileAlignment::BottomLeft:
+			left = tile.offset.x;
+			top = tile.offset.y + 2*h2 - tile.useful_space.height;
+			break;
+		case TileAlignment::BottomRight:
+			left = tile.offset.x + 2*w2 - tile.useful_space.width;
+			top = tile.offset.y + 2*h2 - tile.useful_space.height;
+			break;
+		case TileAlignment::TopLeft:
+		default:
+			left = tile.offset.x;
+			top = tile.offset.y;
+			break;
+		}
+
+		tile.quad = Rectangle(left, top, tile.useful_space.width, tile.useful_space.height);
+	}
 }
@@ -24,6 +24,7 @@
 #define BEARLIBTERMINAL_TILESET_HPP
 
 #include "Atlas.hpp"
+#include "Codespace.hpp"
 #include "OptionGroup.hpp"
 #include <memory>
 #include <map>
@@ -38,6 +39,10 @@ namespace BearLibTerminal
 		char32_t GetOffset() const;
 		virtual bool Provides(char32_t code);
 		virtual std::shared_ptr<TileInfo> Get(char32_t code);
+		// Forgets a tile evicted from the atlas so that Get prepares it anew and its bitmap
+		// is freed meanwhile. Tiles that cannot be prepared again, e. g. cut from an image
+		// which is not kept, stay in the cache.
+		virtual void Evict(char32_t code);
 		virtual Size GetBoundingBoxSize() = 0; // FIXME: refactor to tile property
 		virtual Size GetSpacing() const;
 
@@ -53,23 +58,39 @@ namespace BearLibTerminal
 		Size m_spacing;
 	};
 
-	extern std::unordered_map<char32_t, std::shared_ptr<TileInfo>> g_codespace;
+	extern Codespace g_codespace;
 
 	extern std::map<char32_t, std::shared_ptr<Tileset>> g_tilesets;
 
 	extern std::shared_ptr<Tileset> g_dynamic_tileset;
 
+	// Incremented every time tiles leave the codespace, invalidating TileInfo pointers kept elsewhere.
+	extern uint32_t g_tileset_generation;
+
 	void AddTileset(std::shared_ptr<Tileset> tileset);
 
 	void RemoveTileset(std::shared_ptr<Tileset> tileset);
 
 	void RemoveTileset(char32_t offset);
 
+	// Drops tiles not put since the frame, least recently used first, until the tiles left
+	// would fit into half of the atlas budget. Dropped tiles are prepared anew by GetTileInfo
+	// when needed again. Returns the number of tiles dropped; emptied textures are left for
+	// Atlas::CleanUp.
+	size_t EvictTiles(uint32_t frame);
+
 	bool IsDynamicTile(char32_t code);
 
 	Bitmap GenerateDynamicTile(char32_t code, Size size);
 
 	void UpdateDynamicTileset(Size cell_size);
+
+	TileInfo* GetTileInfo(char32_t code);
+
+	// Places the quads of all tiles, present and added later, for a new cell size.
+	void UpdateTileQuads(Size half_cellsize);
+
+	void UpdateTileQuad(TileInfo& tile);
 }
 
 #endif // BEARLIBTERMINAL_TILESET_HPP
@@ -24,12 +24,48 @@
 #include "Geometry.hpp"
 #include "Utility.hpp"
 #include "Log.hpp"
+#include "Platform.hpp"
 #include <cmath>
+#include <cstring>
 #include <freetype/ftlcdfil.h>
 #include <freetype/ftglyph.h>
 
 namespace BearLibTerminal
 {
+	static const uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+
+	static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+	{
+		// FNV-1a.
+		auto bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	// Glyph cache file layout, in native byte order: the header, then glyph_count glyph
+	// records each followed by width*height pixels, then missing_count relative codes
+	// the font does not provide. Codes are relative to the tileset offset.
+	struct GlyphCacheHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t monospace;
+		uint64_t key;
+		int32_t tile_width, tile_height;
+		uint32_t glyph_count, missing_count;
+	};
+
+	struct GlyphCacheRecord
+	{
+		uint32_t code;
+		int32_t dx, dy;
+		int32_t width, height;
+	};
+
+	static const char kGlyphCacheMagic[8] = {'B', 'L', 'T', 'G', 'L', 'Y', 'P', 'H'};
+	static const uint32_t kGlyphCacheVersion = 1;
+
 	TrueTypeTileset::TrueTypeTileset(char32_t offset, std::vector<uint8_t> data, OptionGroup& options):
 		Tileset(offset),
 		m_alignment(TileAlignment::Center),
@@ -38,8 +74,11 @@ namespace BearLibTerminal
 		m_font_face(nullptr),
 		m_render_mode(FT_RENDER_MODE_NORMAL),
 		m_hinting(FT_LOAD_DEFAULT),
+		m_monospace(false),
 		m_use_box_drawing(false),
-		m_use_block_elements(false)
+		m_use_block_elements(false),
+		m_cache_key(0),
+		m_cache_outdated(false)
 	{
 		if (options.attributes.count(L"spacing") && !try_parse(options.attributes[L"spacing"], m_spacing))
 			throw std::runtime_error("TrueTypeTileset: failed to parse 'spacing' attribute");
@@ -107,6 +146,49 @@ namespace BearLibTerminal
 		if (options.attributes.count(L"use-block-elements") && !try_parse(options.attributes[L"use-block-elements"], m_use_block_elements))
 			throw std::runtime_error("TrueTypeTileset: failed to parse 'use-block-elements' attribute");
 
+		m_reference_code = m_codepage->Convert((int)'@');
+		if (m_reference_code == kUnicodeReplacementCharacter)
+		{
+			// Use first character for size reference if font has custom codepage w/o 0x40 code point
+			m_reference_code = m_codepage->Convert(0);
+		}
+
+		if (options.attributes.count(L"size-reference") && !try_parse(options.attributes[L"size-reference"], m_reference_code))
+			throw std::runtime_error("TrueTypeTileset: can't parse 'size-reference' attribute");
+
+		if (m_alignment == TileAlignment::Unknown)
+			m_alignment = TileAlignment::Center;
+
+		m_requested_size = m_tile_size;
+
+		if (options.attributes.count(L"cache"))
+		{
+			// Everything that affects rasterization is a part of the key.
+			m_cache_filename = options.attributes[L"cache"];
+			m_cache_key = HashBytes(kFnvOffsetBasis, m_font_data.data(), m_font_data.size());
+			for (auto& attribute: options.attributes)
+			{
+				if (attribute.first == L"_" || attribute.first == L"cache")
+					continue;
+				std::string pair = UTF8Encoding().Convert(attribute.first + L"=" + attribute.second);
+				m_cache_key = HashBytes(m_cache_key, pair.data(), pair.size() + 1);
+			}
+		}
+
+		if (m_cache_filename.empty() || !LoadGlyphCache())
+			LoadFace();
+	}
+
+	TrueTypeTileset::~TrueTypeTileset()
+	{
+		if (!m_cache_filename.empty() && m_cache_outdated)
+			SaveGlyphCache();
+	}
+
+	void TrueTypeTileset::LoadFace()
+	{
+		m_tile_size = m_requested_size;
+
 		// Trying to initialize FreeType
 		m_font_library = std::shared_ptr<FT_Library>(
 			new FT_Library(),
@@ -139,16 +221,6 @@ namespace BearLibTerminal
 			return (*m_font_face)->glyph->metrics;
 		};
 
-		char32_t reference_code = m_codepage->Convert((int)'@');
-		if (reference_code == kUnicodeReplacementCharacter)
-		{
-			// Use first character for size reference if font has custom codepage w/o 0x40 code point
-			reference_code = m_codepage->Convert(0);
-		}
-
-		if (options.attributes.count(L"size-reference") && !try_parse(options.attributes[L"size-reference"], reference_code))
-			throw std::runtime_error("TrueTypeTileset: can't parse 'size-reference' attribute");
-
 		if (m_tile_size.width == 0)
 		{
 			// Only height was specified, e. g. size=12
@@ -157,7 +229,7 @@ namespace BearLibTerminal
 				throw std::runtime_error("TrueTypeTileset: can't setup font size");
 
 			int dot_width = (int)std::ceil(get_metrics('.').horiAdvance/64.0f/64.0f);
-			int at_width = (int)std::ceil(get_metrics(reference_code).horiAdvance/64.0f/64.0f);
+			int at_width = (int)std::ceil(get_metrics(m_reference_code).horiAdvance/64.0f/64.0f);
 			m_monospace = dot_width == at_width;
 
 			int height = (*m_font_face)->size->metrics.height >> 6;
@@ -177,7 +249,7 @@ namespace BearLibTerminal
 				if (FT_Set_Char_Size(*m_font_face, 0, (uint32_t)(height*64), 96*hres, 96))
 					throw std::runtime_error("TrueTypeTileset: can't setup font size");
 
-				int w = (int)std::ceil(get_metrics(reference_code).horiAdvance/64.0f/64.0f);
+				int w = (int)std::ceil(get_metrics(m_reference_code).horiAdvance/64.0f/64.0f);
 				int h = (*m_font_face)->size->metrics.height >> 6;
 
 				return Size{w, h};
@@ -217,7 +289,7 @@ namespace BearLibTerminal
 			}
 
 			int dot_width = (int)std::ceil(get_metrics('.').horiAdvance/64.0f/64.0f);
-			int at_width = (int)std::ceil(get_metrics(reference_code).horiAdvance/64.0f/64.0f);
+			int at_width = (int)std::ceil(get_metrics(m_reference_code).horiAdvance/64.0f/64.0f);
 			m_monospace = dot_width == at_width;
 
 			//int height = (*m_font_face)->size->metrics.height >> 6;
@@ -231,9 +303,6 @@ namespace BearLibTerminal
 			FT_Library_SetLcdFilter(*m_font_library, FT_LCD_FILTER_DEFAULT);
 			FT_Library_SetLcdFilterWeights(*m_font_library, (unsigned char*)"\x20\x70\x70\x70\x20");
 		}
-
-		if (m_alignment == TileAlignment::Unknown)
-			m_alignment = TileAlignment::Center;
 	}
 
 	FT_UInt TrueTypeTileset::GetGlyphIndex(char32_t code)
@@ -241,6 +310,9 @@ namespace BearLibTerminal
 		if (code < m_offset)
 			return 0;
 
+		if (!m_font_face)
+			LoadFace();
+
 		if (Tileset::IsFontOffset(m_offset))
 		{
 			// Font
@@ -271,7 +343,20 @@ namespace BearLibTerminal
 			}
 		}
 
-		return GetGlyphIndex(code) > 0;
+		if (m_cache.count(code) || m_cached_glyphs.count(code))
+			return true;
+
+		if (m_missing_glyphs.count(code))
+			return false;
+
+		bool provided = GetGlyphIndex(code) > 0;
+		if (!provided && !m_cache_filename.empty())
+		{
+			m_missing_glyphs.insert(code);
+			m_cache_outdated = true;
+		}
+
+		return provided;
 	}
 
 	std::shared_ptr<TileInfo> TrueTypeTileset::Get(char32_t code)
@@ -279,6 +364,16 @@ namespace BearLibTerminal
 		if (auto cached = Tileset::Get(code))
 			return cached;
 
+		auto i = m_cached_glyphs.find(code);
+		if (i != m_cached_glyphs.end())
+		{
+			// Rasterized in a previous session.
+			auto tile = i->second;
+			m_cached_glyphs.erase(i);
+			m_cache[code] = tile;
+			return tile;
+		}
+
 		FT_UInt index = GetGlyphIndex(code);
 		if (index == 0)
 			throw std::runtime_error("TrueTypeTileset: request for a tile that is not provided by the tileset");
@@ -381,13 +476,149 @@ namespace BearLibTerminal
 		tile->alignment = m_alignment;
 		tile->spacing = m_spacing;
 		m_cache[code] = tile;
+		m_cache_outdated = true;
 
 		return tile;
 	}
 
+	void TrueTypeTileset::Evict(char32_t code)
+	{
+		// Rasterized again if needed; until then the glyph is also left out of the cache file.
+		m_cache.erase(code);
+	}
+
 	Size TrueTypeTileset::GetBoundingBoxSize()
 	{
 		return m_tile_size;
 	}
+
+	bool TrueTypeTileset::LoadGlyphCache()
+	{
+		if (!FileExists(m_cache_filename))
+			return false;
+
+		std::vector<uint8_t> data;
+		try
+		{
+			data = ReadFile(m_cache_filename);
+		}
+		catch (std::exception& e)
+		{
+			LOG(Warning, "TrueTypeTileset: failed to read glyph cache: " << e.what());
+			return false;
+		}
+
+		size_t position = 0;
+		auto read = [&](void* out, size_t size) -> bool
+		{
+			if (data.size() - position < size)
+				return false;
+			std::memcpy(out, data.data() + position, size);
+			position += size;
+			return true;
+		};
+
+		GlyphCacheHeader header;
+		if (!read(&header, sizeof(header)) ||
+			std::memcmp(header.magic, kGlyphCacheMagic, sizeof(kGlyphCacheMagic)) != 0 ||
+			header.version != kGlyphCacheVersion ||
+			header.key != m_cache_key)
+		{
+			LOG(Debug, "TrueTypeTileset: glyph cache '" << m_cache_filename << "' does not match the font");
+			return false;
+		}
+
+		std::unordered_map<char32_t, std::shared_ptr<TileInfo>> glyphs;
+		for (uint32_t i = 0; i < header.glyph_count; i++)
+		{
+			GlyphCacheRecord record;
+			if (!read(&record, sizeof(record)) ||
+				record.width < 0 || record.height < 0 ||
+				(data.size() - position) / sizeof(Color) / std::max(record.width, 1) < (size_t)record.height)
+			{
+				LOG(Warning, "TrueTypeTileset: glyph cache '" << m_cache_filename << "' is truncated");
+				return false;
+			}
+
+			Bitmap bitmap(Size(record.width, record.height), (const Color*)(data.data() + position));
+			position += record.width * record.height * sizeof(Color);
+
+			auto tile = std::make_shared<TileInfo>();
+			tile->tileset = this;
+			tile->bitmap = std::move(bitmap);
+			tile->offset = Point(record.dx, record.dy);
+			tile->alignment = m_alignment;
+			tile->spacing = m_spacing;
+			glyphs[m_offset + record.code] = tile;
+		}
+
+		std::unordered_set<char32_t> missing;
+		for (uint32_t i = 0; i < header.missing_count; i++)
+		{
+			uint32_t code;
+			if (!read(&code, sizeof(code)))
+			{
+				LOG(Warning, "TrueTypeTileset: glyph cache '" << m_cache_filename << "' is truncated");
+				return false;
+			}
+			missing.insert(m_offset + code);
+		}
+
+		m_tile_size = Size(header.tile_width, header.tile_height);
+		m_monospace = header.monospace != 0;
+		m_cached_glyphs = std::move(glyphs);
+		m_missing_glyphs = std::move(missing);
+
+		LOG(Debug, "TrueTypeTileset: loaded " << m_cached_glyphs.size() << " glyphs from cache '" << m_cache_filename << "'");
+		return true;
+	}
+
+	void TrueTypeTileset::SaveGlyphCache()
+	{
+		// Only glyphs used in this session are kept.
+		GlyphCacheHeader header;
+		std::memcpy(header.magic, kGlyphCacheMagic, sizeof(kGlyphCacheMagic));
+		header.version = kGlyphCacheVersion;
+		header.monospace = m_monospace? 1: 0;
+		header.key = m_cache_key;
+		header.tile_width = m_tile_size.width;
+		header.tile_height = m_tile_size.height;
+		header.glyph_count = (uint32_t)m_cache.size();
+		header.missing_count = (uint32_t)m_missing_glyphs.size();
+
+		try
+		{
+			auto stream = OpenFileWriting(m_cache_filename);
+			stream->write((const char*)&header, sizeof(header));
+
+			for (auto& i: m_cache)
+			{
+				const Bitmap& bitmap = i.second->bitmap;
+				GlyphCacheRecord record;
+				record.code = i.first - m_offset;
+				record.dx = i.second->offset.x;
+				record.dy = i.second->offset.y;
+				record.width = bitmap.GetSize().width;
+				record.height = bitmap.GetSize().height;
+				stream->write((const char*)&record, sizeof(record));
+				stream->write((const char*)bitmap.GetData(), bitmap.GetSize().Area() * sizeof(Color));
+			}
+
+			for (char32_t code: m_missing_glyphs)
+			{
+				uint32_t relative_code = code - m_offset;
+				stream->write((const char*)&relative_code, sizeof(relative_code));
+			}
+
+			if (stream->fail())
+				throw std::runtime_error("write error");
+
+			LOG(Debug, "TrueTypeTileset: saved " << m_cache.size() << " glyphs to cache '" << m_cache_filename << "'");
+		}
+		catch (std::exception& e)
+		{
+			LOG(Warning, "TrueTypeTileset: failed to save glyph cache '" << m_cache_filename << "': " << e.what());
+		}
+	}
 }
 
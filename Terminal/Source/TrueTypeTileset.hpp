@@ -24,6 +24,7 @@
 #define TRUETYPETILESET_HPP_
 
 #include <vector>
+#include <unordered_set>
 #include <stdint.h>
 #include "Tileset.hpp"
 #include "Encoding.hpp"
@@ -37,13 +38,20 @@ namespace BearLibTerminal
 	{
 	public:
 		TrueTypeTileset(char32_t offset, std::vector<uint8_t> data, OptionGroup& options);
+		~TrueTypeTileset();
 		bool Provides(char32_t code);
 		std::shared_ptr<TileInfo> Get(char32_t code);
+		void Evict(char32_t code);
 		Size GetBoundingBoxSize();
 
 	private:
+		void LoadFace();
 		FT_UInt GetGlyphIndex(char32_t code);
+		bool LoadGlyphCache();
+		void SaveGlyphCache();
+		Size m_requested_size;
 		Size m_tile_size;
+		char32_t m_reference_code;
 		TileAlignment m_alignment;
 		std::unique_ptr<Encoding8> m_codepage;
 		std::vector<uint8_t> m_font_data;
@@ -54,6 +62,14 @@ namespace BearLibTerminal
 		bool m_monospace;
 		bool m_use_box_drawing;
 		bool m_use_block_elements;
+
+		// Glyphs rasterized in a previous session, see the 'cache' attribute. The face is
+		// only loaded once a glyph is not found there, so a warm start skips FreeType.
+		std::wstring m_cache_filename;
+		uint64_t m_cache_key;
+		std::unordered_map<char32_t, std::shared_ptr<TileInfo>> m_cached_glyphs;
+		std::unordered_set<char32_t> m_missing_glyphs;
+		bool m_cache_outdated;
 	};
 }
 
@@ -28,6 +28,10 @@
 #include <algorithm>
 #include <memory>
 #include <vector>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace BearLibTerminal
 {
@@ -154,6 +158,26 @@ namespace BearLibTerminal
 		return gettime() - start;
 	}
 
+	// Index of the lowest set bit, value must not be zero.
+	inline int count_trailing_zeros(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+#if defined(_WIN64)
+		_BitScanForward64(&index, value);
+#else
+		if (!_BitScanForward(&index, (unsigned long)value))
+		{
+			_BitScanForward(&index, (unsigned long)(value >> 32));
+			index += 32;
+		}
+#endif
+		return (int)index;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
 	template<typename T> class average
 	{
 	public:
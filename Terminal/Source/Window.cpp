@@ -21,6 +21,7 @@
 */
 
 #include "Window.hpp"
+#include "HeadlessWindow.hpp"
 #if defined(__linux)
 #include "X11Window.hpp"
 #endif
@@ -54,6 +55,16 @@ namespace BearLibTerminal
 		if (m_minimum_size.height < 1) m_minimum_size.height = 1;
 	}
 
+	bool Window::AcquireRC()
+	{
+		return false;
+	}
+
+	bool Window::ReleaseRC()
+	{
+		return false;
+	}
+
 	bool Window::IsFullscreen() const
 	{
 		return m_fullscreen;
@@ -64,8 +75,16 @@ namespace BearLibTerminal
 		return std::wstring{};
 	}
 
-	std::unique_ptr<Window> Window::Create(EventHandler handler)
+	bool Window::IsKnownBackend(const std::wstring& name)
 	{
+		return name == L"native" || name == L"headless";
+	}
+
+	std::unique_ptr<Window> Window::Create(const std::wstring& backend, EventHandler handler)
+	{
+		if (backend == L"headless")
+			return std::make_unique<HeadlessWindow>(handler);
+
 #if defined(__linux)
 		return std::make_unique<X11Window>(handler);
 #endif
@@ -31,6 +31,7 @@
 #include <memory>
 #include <utility>
 #include <functional>
+#include <string>
 
 // For internal usage
 #define TK_REDRAW        0x1001
@@ -53,13 +54,16 @@ namespace BearLibTerminal
 		virtual void Show() = 0;
 		virtual void Hide() = 0;
 		virtual void SwapBuffers() = 0;
+		virtual bool AcquireRC(); // Makes the OpenGL context current in the calling thread.
+		virtual bool ReleaseRC();
 		virtual void SetVSync(bool enabled) = 0;
 		virtual void SetResizeable(bool resizeable) = 0;
 		virtual void SetFullscreen(bool fullscreen) = 0;
 		virtual void SetCursorVisibility(bool visible) = 0;
 		bool IsFullscreen() const;
 		virtual int PumpEvents() = 0;
-		static std::unique_ptr<Window> Create(EventHandler handler);
+		static bool IsKnownBackend(const std::wstring& name);
+		static std::unique_ptr<Window> Create(const std::wstring& backend, EventHandler handler);
 	protected:
 		Window(EventHandler handler);
 		EventHandler m_event_handler;
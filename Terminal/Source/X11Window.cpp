@@ -956,14 +956,14 @@ namespace BearLibTerminal
 		return processed;
 	}
 
-	void X11Window::AcquireRC()
+	bool X11Window::AcquireRC()
 	{
-		glXMakeCurrent(m_display, m_window, m_glx);
+		return glXMakeCurrent(m_display, m_window, m_glx) == True;
 	}
 
-	void X11Window::ReleaseRC()
+	bool X11Window::ReleaseRC()
 	{
-		glXMakeCurrent(m_display, None, nullptr);
+		return glXMakeCurrent(m_display, None, nullptr) == True;
 	}
 
 	void X11Window::SwapBuffers()
@@ -43,8 +43,8 @@ namespace BearLibTerminal
 		void SetClientSize(const Size& size);
 		void Show();
 		void Hide();
-		void AcquireRC();
-		void ReleaseRC();
+		bool AcquireRC();
+		bool ReleaseRC();
 		void SwapBuffers();
 		void SetVSync(bool enabled);
 		int PumpEvents();